@@ -0,0 +1,94 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "audio-forward.h"
+#include "source-clone.h"
+#include "clone-trace.h"
+
+static struct {
+	pthread_mutex_t mutex;
+	pthread_t thread;
+	os_sem_t *sem;
+	volatile bool stop;
+	bool running;
+	bool joining;
+	DARRAY(struct source_clone *) clones;
+} forward = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static void *audio_forward_thread(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_set_thread_name("source-clone: audio forward");
+	while (os_sem_wait(forward.sem) == 0) {
+		if (os_atomic_load_bool(&forward.stop))
+			break;
+		struct clone_scope scope;
+		clone_scope_start(&scope, "source_clone_audio_forward", CLONE_TRACE_FORWARD);
+		pthread_mutex_lock(&forward.mutex);
+		for (size_t i = 0; i < forward.clones.num; i++)
+			source_clone_output_audio(forward.clones.array[i]);
+		pthread_mutex_unlock(&forward.mutex);
+		clone_scope_end(&scope);
+	}
+	return NULL;
+}
+
+// called with the mutex held
+static void audio_forward_start(void)
+{
+	if (forward.running || forward.joining || !forward.clones.num)
+		return;
+	if (!forward.sem)
+		os_sem_init(&forward.sem, 0);
+	if (!forward.sem)
+		return;
+	os_atomic_set_bool(&forward.stop, false);
+	forward.running = pthread_create(&forward.thread, NULL, audio_forward_thread, NULL) == 0;
+}
+
+void audio_forward_add(struct source_clone *clone)
+{
+	pthread_mutex_lock(&forward.mutex);
+	da_push_back(forward.clones, &clone);
+	// while the old thread is being joined the remover starts the new one
+	audio_forward_start();
+	pthread_mutex_unlock(&forward.mutex);
+}
+
+void audio_forward_remove(struct source_clone *clone)
+{
+	pthread_mutex_lock(&forward.mutex);
+	da_erase_item(forward.clones, &clone);
+	if (!forward.running || forward.clones.num) {
+		pthread_mutex_unlock(&forward.mutex);
+		return;
+	}
+	da_free(forward.clones);
+	pthread_t thread = forward.thread;
+	forward.running = false;
+	forward.joining = true;
+	os_atomic_set_bool(&forward.stop, true);
+	os_sem_post(forward.sem);
+	pthread_mutex_unlock(&forward.mutex);
+
+	pthread_join(thread, NULL);
+
+	pthread_mutex_lock(&forward.mutex);
+	forward.joining = false;
+	audio_forward_start();
+	pthread_mutex_unlock(&forward.mutex);
+}
+
+void audio_forward_signal(void)
+{
+	os_sem_t *sem = forward.sem;
+	if (sem)
+		os_sem_post(sem);
+}
+
+void audio_forward_free(void)
+{
+	os_sem_destroy(forward.sem);
+	forward.sem = NULL;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <obs.h>
+
+struct source_clone;
+
+void audio_forward_add(struct source_clone *clone);
+
+void audio_forward_remove(struct source_clone *clone);
+
+void audio_forward_signal(void);
+
+void audio_forward_free(void);
@@ -0,0 +1,282 @@
+#include <obs-module.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+#include "audio-ring.h"
+
+#define AUDIO_RING_EXTRA_PACKETS 8
+#define AUDIO_BLOCK_POOL_SIZE 64
+
+enum audio_block_slot {
+	AUDIO_BLOCK_SLOT_EMPTY,
+	AUDIO_BLOCK_SLOT_BUSY,
+	AUDIO_BLOCK_SLOT_FULL,
+};
+
+// released blocks are kept for the audio thread, a slot is claimed by swapping its state
+static struct {
+	struct audio_block *blocks[AUDIO_BLOCK_POOL_SIZE];
+	volatile long state[AUDIO_BLOCK_POOL_SIZE];
+} block_pool;
+
+static uint32_t audio_ring_capacity(uint32_t max_frames)
+{
+	uint32_t packets = (max_frames + AUDIO_OUTPUT_FRAMES - 1) / AUDIO_OUTPUT_FRAMES + AUDIO_RING_EXTRA_PACKETS;
+	uint32_t capacity = 1;
+	while (capacity < packets)
+		capacity <<= 1;
+	return capacity;
+}
+
+static inline void audio_ring_add(volatile long *val, long diff)
+{
+	long old;
+	do {
+		old = os_atomic_load_long(val);
+	} while (!os_atomic_compare_swap_long(val, old, old + diff));
+}
+
+uint32_t audio_ring_frames_from_ms(uint32_t sample_rate, uint32_t ms)
+{
+	uint64_t frames = util_mul_div64(ms, sample_rate, 1000);
+	if (frames < AUDIO_OUTPUT_FRAMES)
+		frames = AUDIO_OUTPUT_FRAMES;
+	return (uint32_t)frames;
+}
+
+void audio_ring_init(struct audio_ring *ring, size_t channels, uint32_t sample_rate, uint32_t max_frames)
+{
+	ring->channels = channels;
+	ring->sample_rate = sample_rate;
+	ring->capacity = audio_ring_capacity(max_frames);
+	os_atomic_set_long(&ring->max_frames, (long)max_frames);
+	ring->packet_size = sizeof(struct audio_ring_packet) + channels * AUDIO_OUTPUT_FRAMES * sizeof(float);
+	ring->packets = bzalloc(ring->packet_size * ring->capacity);
+	os_atomic_set_long(&ring->head, 0);
+	os_atomic_set_long(&ring->tail, 0);
+	os_atomic_set_long(&ring->busy, 0);
+	os_atomic_set_long(&ring->queued_frames, 0);
+}
+
+bool audio_ring_sized_for(const struct audio_ring *ring, uint32_t max_frames)
+{
+	return ring->capacity == audio_ring_capacity(max_frames);
+}
+
+void audio_ring_set_limit(struct audio_ring *ring, uint32_t max_frames, enum audio_overflow overflow)
+{
+	os_atomic_set_long(&ring->max_frames, (long)max_frames);
+	os_atomic_set_long(&ring->overflow, (long)overflow);
+}
+
+static struct audio_block *audio_block_take(size_t channels)
+{
+	for (size_t i = 0; i < AUDIO_BLOCK_POOL_SIZE; i++) {
+		if (!os_atomic_compare_swap_long(&block_pool.state[i], AUDIO_BLOCK_SLOT_FULL, AUDIO_BLOCK_SLOT_BUSY))
+			continue;
+		struct audio_block *block = block_pool.blocks[i];
+		block_pool.blocks[i] = NULL;
+		os_atomic_set_long(&block_pool.state[i], AUDIO_BLOCK_SLOT_EMPTY);
+		if (block->channels == channels)
+			return block;
+		bfree(block);
+	}
+	return bmalloc(sizeof(struct audio_block) + channels * AUDIO_OUTPUT_FRAMES * sizeof(float));
+}
+
+static void audio_block_recycle(struct audio_block *block)
+{
+	for (size_t i = 0; i < AUDIO_BLOCK_POOL_SIZE; i++) {
+		if (!os_atomic_compare_swap_long(&block_pool.state[i], AUDIO_BLOCK_SLOT_EMPTY, AUDIO_BLOCK_SLOT_BUSY))
+			continue;
+		block_pool.blocks[i] = block;
+		os_atomic_set_long(&block_pool.state[i], AUDIO_BLOCK_SLOT_FULL);
+		return;
+	}
+	bfree(block);
+}
+
+void audio_block_pool_free(void)
+{
+	for (size_t i = 0; i < AUDIO_BLOCK_POOL_SIZE; i++) {
+		if (!os_atomic_compare_swap_long(&block_pool.state[i], AUDIO_BLOCK_SLOT_FULL, AUDIO_BLOCK_SLOT_BUSY))
+			continue;
+		bfree(block_pool.blocks[i]);
+		block_pool.blocks[i] = NULL;
+		os_atomic_set_long(&block_pool.state[i], AUDIO_BLOCK_SLOT_EMPTY);
+	}
+}
+
+struct audio_block *audio_block_create(size_t channels, const uint8_t *const *data, uint32_t frames,
+				       uint64_t timestamp)
+{
+	if (frames > AUDIO_OUTPUT_FRAMES)
+		frames = AUDIO_OUTPUT_FRAMES;
+	struct audio_block *block = audio_block_take(channels);
+	block->refs = 1;
+	block->timestamp = timestamp;
+	block->frames = frames;
+	block->channels = channels;
+	for (size_t i = 0; i < channels; i++) {
+		float *dst = audio_block_data(block, i);
+		if (data[i])
+			memcpy(dst, data[i], frames * sizeof(float));
+		else
+			memset(dst, 0, frames * sizeof(float));
+	}
+	return block;
+}
+
+void audio_block_addref(struct audio_block *block)
+{
+	os_atomic_inc_long(&block->refs);
+}
+
+void audio_block_release(struct audio_block *block)
+{
+	if (block && os_atomic_dec_long(&block->refs) == 0)
+		audio_block_recycle(block);
+}
+
+float *audio_block_data(struct audio_block *block, size_t channel)
+{
+	return (float *)((uint8_t *)block + sizeof(struct audio_block)) + channel * AUDIO_OUTPUT_FRAMES;
+}
+
+void audio_ring_free(struct audio_ring *ring)
+{
+	while (audio_ring_peek(ring))
+		audio_ring_pop(ring);
+	bfree(ring->packets);
+	ring->packets = NULL;
+	ring->capacity = 0;
+	os_atomic_set_long(&ring->head, 0);
+	os_atomic_set_long(&ring->tail, 0);
+}
+
+static inline struct audio_ring_packet *audio_ring_get(struct audio_ring *ring, unsigned long idx)
+{
+	return (struct audio_ring_packet *)(ring->packets + (idx % ring->capacity) * ring->packet_size);
+}
+
+float *audio_ring_packet_data(struct audio_ring *ring, struct audio_ring_packet *packet, size_t channel)
+{
+	if (packet->block)
+		return channel < packet->block->channels ? audio_block_data(packet->block, channel) : NULL;
+	return (float *)((uint8_t *)packet + sizeof(struct audio_ring_packet)) + channel * AUDIO_OUTPUT_FRAMES;
+}
+
+static inline bool audio_ring_has_room(struct audio_ring *ring, unsigned long tail, uint32_t frames)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(&ring->head);
+	return tail - head < ring->capacity &&
+	       (uint32_t)os_atomic_load_long(&ring->queued_frames) + frames <=
+		       (uint32_t)os_atomic_load_long(&ring->max_frames);
+}
+
+static void audio_ring_drop(struct audio_ring *ring, struct audio_ring_packet *packet)
+{
+	audio_ring_add(&ring->queued_frames, -(long)packet->frames);
+	audio_block_release(packet->block);
+	packet->block = NULL;
+}
+
+static bool audio_ring_make_room(struct audio_ring *ring, unsigned long tail, uint32_t frames)
+{
+	if (audio_ring_has_room(ring, tail, frames))
+		return true;
+	const long overflow = os_atomic_load_long(&ring->overflow);
+	if (overflow == AUDIO_OVERFLOW_DROP_NEWEST || !os_atomic_compare_swap_long(&ring->busy, 0, 2)) {
+		audio_ring_add(&ring->dropped_frames, (long)frames);
+		return false;
+	}
+
+	unsigned long head = (unsigned long)os_atomic_load_long(&ring->head);
+	while (head != tail && (overflow == AUDIO_OVERFLOW_RESYNC || !audio_ring_has_room(ring, tail, frames))) {
+		struct audio_ring_packet *packet = audio_ring_get(ring, head);
+		audio_ring_add(&ring->dropped_frames, (long)packet->frames);
+		audio_ring_drop(ring, packet);
+		head++;
+		os_atomic_set_long(&ring->head, (long)head);
+	}
+	os_atomic_set_long(&ring->busy, 0);
+	if (audio_ring_has_room(ring, tail, frames))
+		return true;
+	audio_ring_add(&ring->dropped_frames, (long)frames);
+	return false;
+}
+
+bool audio_ring_push(struct audio_ring *ring, const uint8_t *const *data, uint32_t frames, uint64_t timestamp)
+{
+	if (!ring->packets)
+		return false;
+	unsigned long tail = (unsigned long)os_atomic_load_long(&ring->tail);
+	uint32_t offset = 0;
+	while (offset < frames) {
+		uint32_t count = frames - offset;
+		if (count > AUDIO_OUTPUT_FRAMES)
+			count = AUDIO_OUTPUT_FRAMES;
+		if (!audio_ring_make_room(ring, tail, count))
+			return false;
+
+		struct audio_ring_packet *packet = audio_ring_get(ring, tail);
+		packet->frames = count;
+		packet->block = NULL;
+		packet->timestamp = timestamp + util_mul_div64(offset, 1000000000ULL, ring->sample_rate);
+		for (size_t i = 0; i < ring->channels; i++) {
+			float *dst = audio_ring_packet_data(ring, packet, i);
+			if (data[i])
+				memcpy(dst, (const float *)data[i] + offset, count * sizeof(float));
+			else
+				memset(dst, 0, count * sizeof(float));
+		}
+		offset += count;
+		tail++;
+		audio_ring_add(&ring->queued_frames, (long)count);
+		os_atomic_set_long(&ring->tail, (long)tail);
+	}
+	return true;
+}
+
+bool audio_ring_push_block(struct audio_ring *ring, struct audio_block *block)
+{
+	if (!ring->packets)
+		return false;
+	unsigned long tail = (unsigned long)os_atomic_load_long(&ring->tail);
+	if (!audio_ring_make_room(ring, tail, block->frames))
+		return false;
+
+	struct audio_ring_packet *packet = audio_ring_get(ring, tail);
+	audio_block_addref(block);
+	packet->block = block;
+	packet->frames = block->frames;
+	packet->timestamp = block->timestamp;
+	audio_ring_add(&ring->queued_frames, (long)block->frames);
+	os_atomic_set_long(&ring->tail, (long)(tail + 1));
+	return true;
+}
+
+struct audio_ring_packet *audio_ring_peek(struct audio_ring *ring)
+{
+	while (!os_atomic_compare_swap_long(&ring->busy, 0, 1))
+		;
+	unsigned long head = (unsigned long)os_atomic_load_long(&ring->head);
+	unsigned long tail = (unsigned long)os_atomic_load_long(&ring->tail);
+	if (head == tail) {
+		os_atomic_set_long(&ring->busy, 0);
+		return NULL;
+	}
+	return audio_ring_get(ring, head);
+}
+
+void audio_ring_pop(struct audio_ring *ring)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(&ring->head);
+	audio_ring_drop(ring, audio_ring_get(ring, head));
+	os_atomic_set_long(&ring->head, (long)(head + 1));
+	os_atomic_set_long(&ring->busy, 0);
+}
+
+void audio_ring_unpeek(struct audio_ring *ring)
+{
+	os_atomic_set_long(&ring->busy, 0);
+}
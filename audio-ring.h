@@ -0,0 +1,72 @@
+#pragma once
+#include <obs.h>
+
+enum audio_overflow {
+	AUDIO_OVERFLOW_DROP_OLDEST,
+	AUDIO_OVERFLOW_DROP_NEWEST,
+	AUDIO_OVERFLOW_RESYNC,
+};
+
+struct audio_block {
+	volatile long refs;
+	uint64_t timestamp;
+	uint32_t frames;
+	size_t channels;
+};
+
+struct audio_ring_packet {
+	uint64_t timestamp;
+	uint32_t frames;
+	struct audio_block *block;
+};
+
+// single producer (audio thread) / single consumer (graphics thread)
+// the producer only evicts packets when it can take the busy flag without waiting
+struct audio_ring {
+	uint8_t *packets;
+	size_t packet_size;
+	size_t channels;
+	uint32_t capacity;
+	uint32_t sample_rate;
+	// changed on the graphics thread while the audio threads push
+	volatile long max_frames;
+	volatile long overflow;
+	volatile long head;
+	volatile long tail;
+	volatile long busy;
+	volatile long queued_frames;
+	volatile long dropped_frames;
+};
+
+uint32_t audio_ring_frames_from_ms(uint32_t sample_rate, uint32_t ms);
+
+void audio_ring_init(struct audio_ring *ring, size_t channels, uint32_t sample_rate, uint32_t max_frames);
+
+bool audio_ring_sized_for(const struct audio_ring *ring, uint32_t max_frames);
+
+void audio_ring_set_limit(struct audio_ring *ring, uint32_t max_frames, enum audio_overflow overflow);
+
+void audio_ring_free(struct audio_ring *ring);
+
+bool audio_ring_push(struct audio_ring *ring, const uint8_t *const *data, uint32_t frames, uint64_t timestamp);
+
+bool audio_ring_push_block(struct audio_ring *ring, struct audio_block *block);
+
+struct audio_ring_packet *audio_ring_peek(struct audio_ring *ring);
+
+void audio_ring_pop(struct audio_ring *ring);
+
+void audio_ring_unpeek(struct audio_ring *ring);
+
+float *audio_ring_packet_data(struct audio_ring *ring, struct audio_ring_packet *packet, size_t channel);
+
+struct audio_block *audio_block_create(size_t channels, const uint8_t *const *data, uint32_t frames,
+				       uint64_t timestamp);
+
+void audio_block_addref(struct audio_block *block);
+
+void audio_block_release(struct audio_block *block);
+
+float *audio_block_data(struct audio_block *block, size_t channel);
+
+void audio_block_pool_free(void);
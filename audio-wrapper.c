@@ -1,6 +1,8 @@
 #include <obs-module.h>
 #include "audio-wrapper.h"
 #include "source-clone.h"
+#include "audio-forward.h"
+#include "clone-trace.h"
 
 struct audio_wrapper_info *audio_wrapper_get(bool create)
 {
@@ -103,46 +105,72 @@ void audio_wrapper_destroy(void *data)
 			clone->audio_wrapper = NULL;
 	}
 	da_free(aw->clones);
+	da_free(aw->mixes);
 	bfree(data);
 }
 
+struct audio_wrapper_mix {
+	obs_source_t *source;
+	struct audio_block *block;
+};
+
+static struct audio_block *audio_wrapper_get_block(struct audio_wrapper_mix *mixes, size_t *count,
+						   obs_source_t *source, uint32_t mixers, size_t channels)
+{
+	for (size_t i = 0; i < *count; i++) {
+		if (mixes[i].source == source)
+			return mixes[i].block;
+	}
+	struct audio_block *block = NULL;
+	if (!obs_source_audio_pending(source)) {
+		struct obs_source_audio_mix child_audio;
+		obs_source_get_audio_mix(source, &child_audio);
+		uint64_t timestamp = obs_source_get_audio_timestamp(source);
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+			if ((mixers & (1 << mix)) == 0)
+				continue;
+			block = audio_block_create(channels, (const uint8_t *const *)child_audio.output[mix].data,
+						   AUDIO_OUTPUT_FRAMES, timestamp);
+			break;
+		}
+	}
+	mixes[*count].source = obs_source_get_ref(source);
+	mixes[*count].block = block;
+	(*count)++;
+	return block;
+}
+
 bool audio_wrapper_render(void *data, uint64_t *ts_out, struct obs_source_audio_mix *audio, uint32_t mixers,
 			  size_t channels, size_t sample_rate)
 {
 	UNUSED_PARAMETER(ts_out);
 	UNUSED_PARAMETER(audio);
-	UNUSED_PARAMETER(mixers);
 	UNUSED_PARAMETER(sample_rate);
 	struct audio_wrapper_info *aw = (struct audio_wrapper_info *)data;
+	if (!aw->clones.num)
+		return false;
+	struct clone_scope scope;
+	clone_scope_start(&scope, "audio_wrapper_render", CLONE_TRACE_AUDIO);
+	// only grows when clones are added, so the audio thread does not allocate per call
+	da_reserve(aw->mixes, aw->clones.num);
+	struct audio_wrapper_mix *mixes = aw->mixes.array;
+	size_t count = 0;
 	for (size_t i = 0; i < aw->clones.num; i++) {
 		struct source_clone *clone = aw->clones.array[i];
 		obs_source_t *source = obs_weak_source_get_source(clone->clone);
 		if (!source)
 			continue;
-		if (obs_source_audio_pending(source)) {
-			obs_source_release(source);
-			continue;
-		}
-
-		struct obs_source_audio_mix child_audio;
-		obs_source_get_audio_mix(source, &child_audio);
-		uint64_t timestamp = obs_source_get_audio_timestamp(source);
-		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-			if ((mixers & (1 << mix)) == 0)
-				continue;
-			pthread_mutex_lock(&clone->audio_mutex);
-			uint32_t frames = AUDIO_OUTPUT_FRAMES;
-			for (size_t j = 0; j < channels; j++) {
-				deque_push_back(&clone->audio_data[j], child_audio.output[mix].data[j],
-						frames * sizeof(float));
-			}
-			deque_push_back(&clone->audio_frames, &frames, sizeof(frames));
-			deque_push_back(&clone->audio_timestamps, &timestamp, sizeof(timestamp));
-			pthread_mutex_unlock(&clone->audio_mutex);
-			break;
-		}
+		struct audio_block *block = audio_wrapper_get_block(mixes, &count, source, mixers, channels);
+		struct audio_ring *ring = source_clone_audio_ring(clone);
+		if (block && ring && audio_ring_push_block(ring, block) && clone->audio_low_latency)
+			audio_forward_signal();
 		obs_source_release(source);
 	}
+	for (size_t i = 0; i < count; i++) {
+		audio_block_release(mixes[i].block);
+		obs_source_release(mixes[i].source);
+	}
+	clone_scope_end(&scope);
 	return false;
 }
 
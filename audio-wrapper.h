@@ -4,6 +4,7 @@
 struct audio_wrapper_info {
 	obs_source_t *source;
 	DARRAY(struct source_clone *) clones;
+	DARRAY(struct audio_wrapper_mix) mixes;
 	uint32_t channel;
 };
 
@@ -0,0 +1,631 @@
+#include <obs.h>
+#include <obs-nix-platform.h>
+#include <util/base.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+#include <X11/Xlib.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCHMARK_WIDTH 1920
+#define BENCHMARK_HEIGHT 1080
+#define BENCHMARK_FPS 60
+#define BENCHMARK_SAMPLE_RATE 48000
+#define BENCHMARK_MAX_CLONES 1000
+#define BENCHMARK_WARMUP_MS 1000
+#define BENCHMARK_GPU_TIMERS 8
+#define BENCHMARK_TONE_STEP (440.0f * 2.0f * 3.14159265f / (float)BENCHMARK_SAMPLE_RATE)
+
+enum benchmark_mode {
+	BENCHMARK_DIRECT,
+	BENCHMARK_BUFFERED,
+	BENCHMARK_CURRENT_SCENE,
+	BENCHMARK_PREVIOUS_SCENE,
+};
+
+static const char *benchmark_mode_names[] = {"direct", "buffered", "current", "previous"};
+
+struct benchmark_options {
+	const char *module_path;
+	const char *data_path;
+	DARRAY(long) clones;
+	DARRAY(enum benchmark_mode) modes;
+	DARRAY(bool) audio;
+	long seconds;
+	bool verbose;
+};
+
+struct benchmark_source {
+	obs_source_t *source;
+	pthread_t audio_thread;
+	os_event_t *stop;
+	bool audio_running;
+};
+
+struct benchmark_gpu_timer {
+	gs_timer_range_t *range;
+	gs_timer_t *timer;
+	bool pending;
+};
+
+struct benchmark_run {
+	obs_source_t *target;
+	obs_scene_t *target_scene;
+	obs_scene_t *other_scene;
+	obs_scene_t *clone_scene;
+	DARRAY(obs_source_t *) clones;
+	bool showing;
+	gs_texrender_t *render;
+	struct benchmark_gpu_timer gpu[BENCHMARK_GPU_TIMERS];
+	uint64_t renders;
+	volatile bool measuring;
+	uint64_t frames;
+	uint64_t cpu_total;
+	uint64_t cpu_max;
+	uint64_t gpu_frames;
+	uint64_t gpu_total;
+	uint64_t gpu_max;
+};
+
+struct benchmark_scope {
+	const char *prefix;
+	uint64_t time;
+	uint64_t count;
+};
+
+static bool benchmark_verbose = false;
+
+static void benchmark_log(int lvl, const char *msg, va_list args, void *param)
+{
+	UNUSED_PARAMETER(param);
+	if (lvl > LOG_WARNING && !benchmark_verbose)
+		return;
+	vfprintf(stderr, msg, args);
+	fputc('\n', stderr);
+}
+
+/* ------------------------------------------------------------------------- */
+/* synthetic target: a full frame solid fill and a steady stereo tone        */
+
+static void *benchmark_audio_thread(void *data)
+{
+	struct benchmark_source *bs = data;
+	float samples[AUDIO_OUTPUT_FRAMES];
+	for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++)
+		samples[i] = 0.25f * sinf((float)i * BENCHMARK_TONE_STEP);
+
+	const uint64_t interval = util_mul_div64(AUDIO_OUTPUT_FRAMES, 1000000000ULL, BENCHMARK_SAMPLE_RATE);
+	uint64_t timestamp = os_gettime_ns();
+	while (os_event_try(bs->stop) == EAGAIN) {
+		struct obs_source_audio audio = {0};
+		audio.data[0] = (const uint8_t *)samples;
+		audio.data[1] = (const uint8_t *)samples;
+		audio.frames = AUDIO_OUTPUT_FRAMES;
+		audio.speakers = SPEAKERS_STEREO;
+		audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
+		audio.samples_per_sec = BENCHMARK_SAMPLE_RATE;
+		audio.timestamp = timestamp;
+		obs_source_output_audio(bs->source, &audio);
+		timestamp += interval;
+		os_sleepto_ns(timestamp);
+	}
+	return NULL;
+}
+
+static const char *benchmark_source_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Clone Benchmark Source";
+}
+
+static void *benchmark_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct benchmark_source *bs = bzalloc(sizeof(struct benchmark_source));
+	bs->source = source;
+	if (!obs_data_get_bool(settings, "audio"))
+		return bs;
+	if (os_event_init(&bs->stop, OS_EVENT_TYPE_MANUAL) == 0)
+		bs->audio_running = pthread_create(&bs->audio_thread, NULL, benchmark_audio_thread, bs) == 0;
+	return bs;
+}
+
+static void benchmark_source_destroy(void *data)
+{
+	struct benchmark_source *bs = data;
+	if (bs->audio_running) {
+		os_event_signal(bs->stop);
+		pthread_join(bs->audio_thread, NULL);
+	}
+	os_event_destroy(bs->stop);
+	bfree(bs);
+}
+
+static void benchmark_source_render(void *data, gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(effect);
+	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	struct vec4 color;
+	vec4_set(&color, 0.2f, 0.4f, 0.8f, 1.0f);
+	gs_effect_set_vec4(gs_effect_get_param_by_name(solid, "color"), &color);
+	while (gs_effect_loop(solid, "Solid"))
+		gs_draw_sprite(NULL, 0, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+}
+
+static uint32_t benchmark_source_get_width(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return BENCHMARK_WIDTH;
+}
+
+static uint32_t benchmark_source_get_height(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return BENCHMARK_HEIGHT;
+}
+
+static struct obs_source_info benchmark_source_info = {
+	.id = "source_clone_benchmark_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_AUDIO,
+	.get_name = benchmark_source_get_name,
+	.create = benchmark_source_create,
+	.destroy = benchmark_source_destroy,
+	.video_render = benchmark_source_render,
+	.get_width = benchmark_source_get_width,
+	.get_height = benchmark_source_get_height,
+};
+
+/* ------------------------------------------------------------------------- */
+/* measuring                                                                 */
+
+static void benchmark_collect_gpu(struct benchmark_run *run, struct benchmark_gpu_timer *gpu, bool measuring)
+{
+	if (!gpu->pending)
+		return;
+	gpu->pending = false;
+	bool disjoint;
+	uint64_t frequency;
+	uint64_t ticks;
+	// a query that is not ready a few frames later is dropped instead of stalling the graphics thread
+	if (!gs_timer_range_get_data(gpu->range, &disjoint, &frequency) || disjoint || !frequency ||
+	    !gs_timer_get_data(gpu->timer, &ticks) || !measuring)
+		return;
+	const uint64_t elapsed = util_mul_div64(ticks, 1000000000ULL, frequency);
+	run->gpu_frames++;
+	run->gpu_total += elapsed;
+	if (elapsed > run->gpu_max)
+		run->gpu_max = elapsed;
+}
+
+static void benchmark_rendered(void *param)
+{
+	struct benchmark_run *run = param;
+	// the warmup renders as well, so first frame allocations stay out of the measurement
+	const bool measuring = os_atomic_load_bool(&run->measuring);
+
+	struct benchmark_gpu_timer *gpu = &run->gpu[run->renders++ % BENCHMARK_GPU_TIMERS];
+	benchmark_collect_gpu(run, gpu, measuring);
+	if (!gpu->range) {
+		gpu->range = gs_timer_range_create();
+		gpu->timer = gs_timer_create();
+	}
+	if (!run->render)
+		run->render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	gs_texrender_reset(run->render);
+
+	const uint64_t start = os_gettime_ns();
+	if (gpu->range && gpu->timer) {
+		gs_timer_range_begin(gpu->range);
+		gs_timer_begin(gpu->timer);
+	}
+	if (gs_texrender_begin(run->render, BENCHMARK_WIDTH, BENCHMARK_HEIGHT)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)BENCHMARK_WIDTH, 0.0f, (float)BENCHMARK_HEIGHT, -100.0f, 100.0f);
+		obs_source_video_render(obs_scene_get_source(run->clone_scene));
+		gs_texrender_end(run->render);
+	}
+	if (gpu->range && gpu->timer) {
+		gs_timer_end(gpu->timer);
+		gs_timer_range_end(gpu->range);
+		gpu->pending = true;
+	}
+	const uint64_t elapsed = os_gettime_ns() - start;
+	if (!measuring)
+		return;
+
+	run->frames++;
+	run->cpu_total += elapsed;
+	if (elapsed > run->cpu_max)
+		run->cpu_max = elapsed;
+}
+
+static bool benchmark_sum_entry(void *context, profiler_snapshot_entry_t *entry)
+{
+	struct benchmark_scope *scope = context;
+	const char *name = profiler_snapshot_entry_name(entry);
+	if (name && strncmp(name, scope->prefix, strlen(scope->prefix)) == 0) {
+		profiler_time_entries_t *times = profiler_snapshot_entry_times(entry);
+		for (size_t i = 0; i < times->num; i++)
+			scope->time += times->array[i].time_delta * times->array[i].count;
+		scope->count += profiler_snapshot_entry_overall_count(entry);
+		// calls nested in a matching scope are already part of its time
+		return true;
+	}
+	profiler_snapshot_enumerate_children(entry, benchmark_sum_entry, context);
+	return true;
+}
+
+static void benchmark_sum(struct benchmark_scope *scopes, size_t count)
+{
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	for (size_t i = 0; i < count; i++) {
+		scopes[i].time = 0;
+		scopes[i].count = 0;
+		profiler_snapshot_enumerate_roots(snap, benchmark_sum_entry, &scopes[i]);
+	}
+	profile_snapshot_free(snap);
+}
+
+static double benchmark_avg_us(uint64_t total_us, uint64_t count)
+{
+	return count ? (double)total_us / (double)count : 0.0;
+}
+
+static long long benchmark_dropped_frames(void)
+{
+	calldata_t cd = {0};
+	long long dropped = 0;
+	if (proc_handler_call(obs_get_proc_handler(), "source_clone_stats", &cd)) {
+		obs_data_t *stats = obs_data_create_from_json(calldata_string(&cd, "stats"));
+		dropped = obs_data_get_int(stats, "audio_dropped_frames");
+		obs_data_release(stats);
+	}
+	calldata_free(&cd);
+	return dropped;
+}
+
+/* ------------------------------------------------------------------------- */
+/* collections                                                               */
+
+static void benchmark_set_current_scene(obs_scene_t *scene)
+{
+	obs_set_output_source(0, scene ? obs_scene_get_source(scene) : NULL);
+}
+
+static bool benchmark_setup(struct benchmark_run *run, long clones, enum benchmark_mode mode, bool audio)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_bool(settings, "audio", audio);
+	run->target = obs_source_create(benchmark_source_info.id, "Clone Benchmark Target", settings, NULL);
+	obs_data_release(settings);
+	if (!run->target)
+		return false;
+
+	// scene clones follow channel 0 of the main canvas, which is where the target scene goes on air
+	run->target_scene = obs_scene_create("Clone Benchmark Target Scene");
+	obs_scene_add(run->target_scene, run->target);
+	run->other_scene = obs_scene_create("Clone Benchmark Other Scene");
+	benchmark_set_current_scene(run->target_scene);
+
+	obs_canvas_t *canvas = obs_get_main_canvas();
+	const char *canvas_name = canvas ? obs_canvas_get_name(canvas) : "";
+	run->clone_scene = obs_scene_create_private("Clone Benchmark Clones");
+	for (long i = 0; i < clones; i++) {
+		settings = obs_data_create();
+		obs_data_set_int(settings, "clone_type",
+				 mode == BENCHMARK_CURRENT_SCENE    ? 1
+				 : mode == BENCHMARK_PREVIOUS_SCENE ? 2
+								    : 0);
+		obs_data_set_string(settings, "canvas", canvas_name);
+		obs_data_set_string(settings, "clone", obs_source_get_name(run->target));
+		obs_data_set_string(settings, "clone_uuid", obs_source_get_uuid(run->target));
+		obs_data_set_int(settings, "buffer_frame", mode == BENCHMARK_DIRECT ? 0 : 1);
+		obs_data_set_bool(settings, "audio", audio);
+		struct dstr name = {0};
+		dstr_printf(&name, "Clone Benchmark %ld", i);
+		obs_source_t *clone = obs_source_create_private("source-clone", name.array, settings);
+		dstr_free(&name);
+		obs_data_release(settings);
+		if (!clone) {
+			obs_canvas_release(canvas);
+			return false;
+		}
+		obs_scene_add(run->clone_scene, clone);
+		da_push_back(run->clones, &clone);
+	}
+	obs_canvas_release(canvas);
+
+	obs_source_t *clone_scene = obs_scene_get_source(run->clone_scene);
+	obs_source_inc_showing(clone_scene);
+	obs_source_inc_active(clone_scene);
+	run->showing = true;
+	if (mode == BENCHMARK_PREVIOUS_SCENE) {
+		// let the clones see the target scene on air before switching away from it
+		os_sleep_ms(100);
+		benchmark_set_current_scene(run->other_scene);
+	}
+	return true;
+}
+
+static void benchmark_teardown(struct benchmark_run *run)
+{
+	if (run->clone_scene) {
+		obs_source_t *clone_scene = obs_scene_get_source(run->clone_scene);
+		if (run->showing) {
+			obs_source_dec_active(clone_scene);
+			obs_source_dec_showing(clone_scene);
+		}
+		obs_scene_release(run->clone_scene);
+	}
+	for (size_t i = 0; i < run->clones.num; i++)
+		obs_source_release(run->clones.array[i]);
+	da_free(run->clones);
+	benchmark_set_current_scene(NULL);
+	if (run->target_scene) {
+		obs_source_remove(obs_scene_get_source(run->target_scene));
+		obs_scene_release(run->target_scene);
+	}
+	if (run->other_scene) {
+		obs_source_remove(obs_scene_get_source(run->other_scene));
+		obs_scene_release(run->other_scene);
+	}
+	if (run->target) {
+		obs_source_remove(run->target);
+		obs_source_release(run->target);
+	}
+	obs_enter_graphics();
+	gs_texrender_destroy(run->render);
+	for (size_t i = 0; i < BENCHMARK_GPU_TIMERS; i++) {
+		if (run->gpu[i].timer)
+			gs_timer_destroy(run->gpu[i].timer);
+		if (run->gpu[i].range)
+			gs_timer_range_destroy(run->gpu[i].range);
+	}
+	obs_leave_graphics();
+	obs_wait_for_destroy_queue();
+}
+
+static bool benchmark_run(const struct benchmark_options *options, long clones, enum benchmark_mode mode, bool audio)
+{
+	struct benchmark_run run = {0};
+	if (!benchmark_setup(&run, clones, mode, audio)) {
+		benchmark_teardown(&run);
+		fprintf(stderr, "could not create %ld %s clones\n", clones, benchmark_mode_names[mode]);
+		return false;
+	}
+	obs_add_main_rendered_callback(benchmark_rendered, &run);
+	os_sleep_ms(BENCHMARK_WARMUP_MS);
+
+	// libobs profiler scopes, the clone ones come from the plugin itself
+	static const char *prefixes[] = {
+		"tick_sources",         "source_clone_video_render(", "audio_thread(",
+		"audio_wrapper_render", "source_clone_audio_drain(",  "source_clone_audio_forward",
+	};
+	struct benchmark_scope before[OBS_COUNTOF(prefixes)];
+	struct benchmark_scope scopes[OBS_COUNTOF(prefixes)];
+	for (size_t i = 0; i < OBS_COUNTOF(prefixes); i++) {
+		before[i].prefix = prefixes[i];
+		scopes[i].prefix = prefixes[i];
+	}
+	const long long dropped_start = benchmark_dropped_frames();
+	benchmark_sum(before, OBS_COUNTOF(before));
+	os_atomic_set_bool(&run.measuring, true);
+	os_sleep_ms((uint32_t)options->seconds * 1000);
+	os_atomic_set_bool(&run.measuring, false);
+	benchmark_sum(scopes, OBS_COUNTOF(scopes));
+	const long long dropped = benchmark_dropped_frames() - dropped_start;
+	obs_remove_main_rendered_callback(benchmark_rendered, &run);
+	for (size_t i = 0; i < OBS_COUNTOF(scopes); i++) {
+		scopes[i].time -= before[i].time;
+		scopes[i].count -= before[i].count;
+	}
+
+	const double frames = run.frames ? (double)run.frames : 1.0;
+	printf("{\"clones\":%ld,\"mode\":\"%s\",\"audio\":%s,\"frames\":%llu,"
+	       "\"render_cpu_avg_us\":%.1f,\"render_cpu_max_us\":%.1f,"
+	       "\"render_gpu_avg_us\":%.1f,\"render_gpu_max_us\":%.1f,\"gpu_frames\":%llu,"
+	       "\"tick_avg_us\":%.1f,\"clone_render_per_frame_us\":%.1f,"
+	       "\"audio_thread_avg_us\":%.1f,\"audio_wrapper_avg_us\":%.1f,"
+	       "\"audio_drain_per_frame_us\":%.1f,\"audio_forward_avg_us\":%.1f,\"audio_dropped_frames\":%lld}\n",
+	       clones, benchmark_mode_names[mode], audio ? "true" : "false", (unsigned long long)run.frames,
+	       (double)run.cpu_total / frames / 1000.0, (double)run.cpu_max / 1000.0,
+	       run.gpu_frames ? (double)run.gpu_total / (double)run.gpu_frames / 1000.0 : 0.0,
+	       (double)run.gpu_max / 1000.0, (unsigned long long)run.gpu_frames,
+	       benchmark_avg_us(scopes[0].time, scopes[0].count), (double)scopes[1].time / frames,
+	       benchmark_avg_us(scopes[2].time, scopes[2].count), benchmark_avg_us(scopes[3].time, scopes[3].count),
+	       (double)scopes[4].time / frames, benchmark_avg_us(scopes[5].time, scopes[5].count), dropped);
+	fflush(stdout);
+
+	benchmark_teardown(&run);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* startup                                                                   */
+
+static void benchmark_usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s --module <source-clone.so> --data <data dir> [options]\n"
+		"  --clones <n,...>    clone counts to run, 1-%d (default 1,10,100,1000)\n"
+		"  --modes <mode,...>  direct, buffered, current, previous (default all)\n"
+		"  --audio <on|off,...> audio settings to run (default off,on)\n"
+		"  --seconds <n>       measured seconds per run (default 5)\n"
+		"  --verbose           pass libobs info logging through\n"
+		"Results are printed as one JSON object per run. The benchmark needs an X11 display,\n"
+		"for example Xvfb with LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe.\n",
+		name, BENCHMARK_MAX_CLONES);
+}
+
+static bool benchmark_parse_list(struct benchmark_options *options, const char *arg, const char *list)
+{
+	char **items = strlist_split(list, ',', false);
+	bool valid = items && *items;
+	for (char **item = items; valid && *item; item++) {
+		if (strcmp(arg, "--clones") == 0) {
+			long clones = strtol(*item, NULL, 10);
+			valid = clones >= 1 && clones <= BENCHMARK_MAX_CLONES;
+			if (valid)
+				da_push_back(options->clones, &clones);
+		} else if (strcmp(arg, "--modes") == 0) {
+			valid = false;
+			for (size_t i = 0; i < OBS_COUNTOF(benchmark_mode_names); i++) {
+				if (strcmp(*item, benchmark_mode_names[i]) == 0) {
+					enum benchmark_mode mode = (enum benchmark_mode)i;
+					da_push_back(options->modes, &mode);
+					valid = true;
+				}
+			}
+		} else {
+			bool audio = strcmp(*item, "on") == 0;
+			valid = audio || strcmp(*item, "off") == 0;
+			if (valid)
+				da_push_back(options->audio, &audio);
+		}
+	}
+	strlist_free(items);
+	return valid;
+}
+
+static bool benchmark_parse(struct benchmark_options *options, int argc, char **argv)
+{
+	options->seconds = 5;
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		if (strcmp(arg, "--verbose") == 0) {
+			options->verbose = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+			return false;
+		const char *value = argv[++i];
+		if (strcmp(arg, "--module") == 0) {
+			options->module_path = value;
+		} else if (strcmp(arg, "--data") == 0) {
+			options->data_path = value;
+		} else if (strcmp(arg, "--seconds") == 0) {
+			options->seconds = strtol(value, NULL, 10);
+			if (options->seconds < 1)
+				return false;
+		} else if (strcmp(arg, "--clones") == 0 || strcmp(arg, "--modes") == 0 || strcmp(arg, "--audio") == 0) {
+			if (!benchmark_parse_list(options, arg, value))
+				return false;
+		} else {
+			return false;
+		}
+	}
+	if (!options->clones.num) {
+		const long defaults[] = {1, 10, 100, 1000};
+		da_push_back_array(options->clones, defaults, OBS_COUNTOF(defaults));
+	}
+	if (!options->modes.num) {
+		for (size_t i = 0; i < OBS_COUNTOF(benchmark_mode_names); i++) {
+			enum benchmark_mode mode = (enum benchmark_mode)i;
+			da_push_back(options->modes, &mode);
+		}
+	}
+	if (!options->audio.num) {
+		const bool defaults[] = {false, true};
+		da_push_back_array(options->audio, defaults, OBS_COUNTOF(defaults));
+	}
+	return options->module_path && options->data_path;
+}
+
+static bool benchmark_start(const struct benchmark_options *options)
+{
+	struct obs_audio_info oai = {
+		.samples_per_sec = BENCHMARK_SAMPLE_RATE,
+		.speakers = SPEAKERS_STEREO,
+	};
+	if (!obs_reset_audio(&oai)) {
+		fprintf(stderr, "could not start libobs audio\n");
+		return false;
+	}
+	struct obs_video_info ovi = {
+		.graphics_module = "libobs-opengl",
+		.fps_num = BENCHMARK_FPS,
+		.fps_den = 1,
+		.base_width = BENCHMARK_WIDTH,
+		.base_height = BENCHMARK_HEIGHT,
+		.output_width = BENCHMARK_WIDTH,
+		.output_height = BENCHMARK_HEIGHT,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "could not start libobs video\n");
+		return false;
+	}
+
+	obs_register_source(&benchmark_source_info);
+	obs_module_t *module = NULL;
+	if (obs_open_module(&module, options->module_path, options->data_path) != MODULE_SUCCESS ||
+	    !obs_init_module(module)) {
+		fprintf(stderr, "could not load %s\n", options->module_path);
+		return false;
+	}
+	obs_post_load_modules();
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	struct benchmark_options options = {0};
+	if (!benchmark_parse(&options, argc, argv)) {
+		benchmark_usage(argv[0]);
+		return 1;
+	}
+	benchmark_verbose = options.verbose;
+	base_set_log_handler(benchmark_log, NULL);
+
+	Display *display = XOpenDisplay(NULL);
+	if (!display) {
+		fprintf(stderr, "no X11 display, run the benchmark under Xvfb\n");
+		return 1;
+	}
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+	obs_set_nix_platform_display(display);
+
+	profiler_start();
+	profiler_name_store_t *names = profiler_name_store_create();
+	int result = 1;
+	if (obs_startup("en-US", NULL, names)) {
+		if (benchmark_start(&options)) {
+			result = 0;
+			for (size_t c = 0; c < options.clones.num && !result; c++) {
+				for (size_t m = 0; m < options.modes.num && !result; m++) {
+					for (size_t a = 0; a < options.audio.num && !result; a++) {
+						if (!benchmark_run(&options, options.clones.array[c],
+								   options.modes.array[m], options.audio.array[a]))
+							result = 1;
+					}
+				}
+			}
+		}
+		obs_shutdown();
+	} else {
+		fprintf(stderr, "could not start libobs\n");
+	}
+	profiler_stop();
+	profiler_name_store_free(names);
+	profiler_free();
+	XCloseDisplay(display);
+
+	da_free(options.clones);
+	da_free(options.modes);
+	da_free(options.audio);
+	return result;
+}
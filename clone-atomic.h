@@ -0,0 +1,27 @@
+#pragma once
+
+// libobs only has atomics for long and bool, these publish pointers read on other threads
+
+#ifdef _MSC_VER
+#include <intrin.h>
+
+static inline void *clone_atomic_load_ptr(void *volatile *ptr)
+{
+	return _InterlockedCompareExchangePointer(ptr, NULL, NULL);
+}
+
+static inline void clone_atomic_store_ptr(void *volatile *ptr, void *val)
+{
+	_InterlockedExchangePointer(ptr, val);
+}
+#else
+static inline void *clone_atomic_load_ptr(void *volatile *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void clone_atomic_store_ptr(void *volatile *ptr, void *val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+#endif
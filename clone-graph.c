@@ -0,0 +1,201 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "clone-graph.h"
+#include "source-clone.h"
+
+struct clone_graph_edge {
+	struct source_clone *clone;
+	obs_weak_source_t *target;
+};
+
+struct clone_graph_node {
+	obs_source_t *source;
+	obs_source_t *target;
+};
+
+struct clone_graph_walk {
+	obs_source_t *origin;
+	const struct clone_graph_node *nodes;
+	size_t node_count;
+	DARRAY(obs_source_t *) visited;
+	bool cycle;
+};
+
+static pthread_mutex_t graph_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct clone_graph_edge) graph_edges;
+static volatile long graph_generation = 0;
+// clones on a cycle, brought up to date with the edges changed since by whichever clone asks first
+static DARRAY(obs_source_t *) cycle_sources;
+// clones with a new target, one of them can only close a cycle if it is reachable from its target
+static DARRAY(obs_source_t *) added_sources;
+// a changed or removed edge can only break the cycles already known
+static bool recheck_cycles = false;
+
+static size_t clone_graph_find(struct source_clone *clone)
+{
+	for (size_t i = 0; i < graph_edges.num; i++) {
+		if (graph_edges.array[i].clone == clone)
+			return i;
+	}
+	return DARRAY_INVALID;
+}
+
+void clone_graph_set(struct source_clone *clone, obs_source_t *target)
+{
+	pthread_mutex_lock(&graph_mutex);
+	size_t idx = clone_graph_find(clone);
+	if (idx == DARRAY_INVALID) {
+		struct clone_graph_edge *edge = da_push_back_new(graph_edges);
+		edge->clone = clone;
+		idx = graph_edges.num - 1;
+	} else {
+		obs_weak_source_t *current = graph_edges.array[idx].target;
+		// an unchanged target leaves the cached cycles valid
+		if (current ? obs_weak_source_references_source(current, target) : !target) {
+			pthread_mutex_unlock(&graph_mutex);
+			return;
+		}
+		if (current)
+			recheck_cycles = true;
+	}
+	obs_weak_source_release(graph_edges.array[idx].target);
+	graph_edges.array[idx].target = obs_source_get_weak_source(target);
+	if (target && da_find(added_sources, &clone->source, 0) == DARRAY_INVALID)
+		da_push_back(added_sources, &clone->source);
+	os_atomic_inc_long(&graph_generation);
+	pthread_mutex_unlock(&graph_mutex);
+}
+
+void clone_graph_remove(struct source_clone *clone)
+{
+	pthread_mutex_lock(&graph_mutex);
+	size_t idx = clone_graph_find(clone);
+	if (idx != DARRAY_INVALID) {
+		obs_weak_source_release(graph_edges.array[idx].target);
+		da_erase(graph_edges, idx);
+		da_erase_item(added_sources, &clone->source);
+		recheck_cycles = true;
+		if (!graph_edges.num) {
+			da_free(graph_edges);
+			da_free(cycle_sources);
+			da_free(added_sources);
+			recheck_cycles = false;
+		}
+	}
+	os_atomic_inc_long(&graph_generation);
+	pthread_mutex_unlock(&graph_mutex);
+}
+
+long clone_graph_generation(void)
+{
+	return os_atomic_load_long(&graph_generation);
+}
+
+static void clone_graph_visit(struct clone_graph_walk *walk, obs_source_t *source);
+
+static void clone_graph_visit_child(obs_source_t *parent, obs_source_t *child, void *param)
+{
+	UNUSED_PARAMETER(parent);
+	struct clone_graph_walk *walk = param;
+	if (walk->cycle)
+		return;
+	if (child == walk->origin) {
+		walk->cycle = true;
+		return;
+	}
+	// the tree walk already covers nested scenes, only clone edges need following
+	for (size_t i = 0; i < walk->node_count; i++) {
+		if (walk->nodes[i].source == child) {
+			clone_graph_visit(walk, walk->nodes[i].target);
+			return;
+		}
+	}
+}
+
+static void clone_graph_visit(struct clone_graph_walk *walk, obs_source_t *source)
+{
+	if (!source || walk->cycle)
+		return;
+	if (source == walk->origin) {
+		walk->cycle = true;
+		return;
+	}
+	for (size_t i = 0; i < walk->visited.num; i++) {
+		if (walk->visited.array[i] == source)
+			return;
+	}
+	da_push_back(walk->visited, &source);
+	clone_graph_visit_child(NULL, source, walk);
+	obs_source_enum_full_tree(source, clone_graph_visit_child, walk);
+}
+
+static bool clone_graph_on_cycle(const struct clone_graph_node *nodes, size_t count, obs_source_t *origin)
+{
+	const struct clone_graph_node *node = NULL;
+	for (size_t i = 0; i < count && !node; i++) {
+		if (nodes[i].source == origin)
+			node = &nodes[i];
+	}
+	if (!node)
+		return false;
+	struct clone_graph_walk walk = {0};
+	walk.origin = origin;
+	walk.nodes = nodes;
+	walk.node_count = count;
+	clone_graph_visit(&walk, node->target);
+	da_free(walk.visited);
+	return walk.cycle;
+}
+
+// called with graph_mutex held, the strong references in nodes are released by the caller after unlocking
+static void clone_graph_update_cycles(const struct clone_graph_node *nodes, size_t count)
+{
+	if (recheck_cycles) {
+		for (size_t i = cycle_sources.num; i > 0; i--) {
+			if (!clone_graph_on_cycle(nodes, count, cycle_sources.array[i - 1]))
+				da_erase(cycle_sources, i - 1);
+		}
+		recheck_cycles = false;
+	}
+	bool closed = false;
+	for (size_t i = 0; i < added_sources.num && !closed; i++)
+		closed = clone_graph_on_cycle(nodes, count, added_sources.array[i]);
+	da_resize(added_sources, 0);
+	if (!closed)
+		return;
+	// the new cycle may run through any clone reachable from the new target, rare enough to look at them all
+	for (size_t i = 0; i < count; i++) {
+		obs_source_t *source = nodes[i].source;
+		if (da_find(cycle_sources, &source, 0) == DARRAY_INVALID && clone_graph_on_cycle(nodes, count, source))
+			da_push_back(cycle_sources, &source);
+	}
+}
+
+bool clone_graph_has_cycle(obs_source_t *origin)
+{
+	DARRAY(struct clone_graph_node) nodes;
+	da_init(nodes);
+
+	pthread_mutex_lock(&graph_mutex);
+	if (recheck_cycles || added_sources.num) {
+		for (size_t i = 0; i < graph_edges.num; i++) {
+			obs_source_t *target = obs_weak_source_get_source(graph_edges.array[i].target);
+			if (!target)
+				continue;
+			struct clone_graph_node *node = da_push_back_new(nodes);
+			node->source = graph_edges.array[i].clone->source;
+			node->target = target;
+		}
+		clone_graph_update_cycles(nodes.array, nodes.num);
+	}
+	bool cycle = false;
+	for (size_t i = 0; i < cycle_sources.num && !cycle; i++)
+		cycle = cycle_sources.array[i] == origin;
+	pthread_mutex_unlock(&graph_mutex);
+
+	for (size_t i = 0; i < nodes.num; i++)
+		obs_source_release(nodes.array[i].target);
+	da_free(nodes);
+	return cycle;
+}
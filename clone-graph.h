@@ -0,0 +1,12 @@
+#pragma once
+#include <obs.h>
+
+struct source_clone;
+
+void clone_graph_set(struct source_clone *clone, obs_source_t *target);
+
+void clone_graph_remove(struct source_clone *clone);
+
+long clone_graph_generation(void);
+
+bool clone_graph_has_cycle(obs_source_t *origin);
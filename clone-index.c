@@ -0,0 +1,140 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "clone-index.h"
+#include "source-clone.h"
+
+struct clone_index_entry {
+	char *key;
+	DARRAY(struct source_clone *) clones;
+};
+
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct clone_index_entry) index_entries;
+
+static void clone_index_key(struct dstr *key, int clone_type, const char *target)
+{
+	dstr_printf(key, "%d:%s", clone_type, clone_type == CLONE_SOURCE && target ? target : "");
+}
+
+static size_t clone_index_search(const char *key, bool *found)
+{
+	size_t low = 0;
+	size_t high = index_entries.num;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		int cmp = strcmp(index_entries.array[mid].key, key);
+		if (cmp == 0) {
+			*found = true;
+			return mid;
+		}
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	*found = false;
+	return low;
+}
+
+static void clone_index_insert(struct source_clone *clone, const char *key)
+{
+	bool found;
+	size_t idx = clone_index_search(key, &found);
+	if (!found) {
+		struct clone_index_entry *entry = da_insert_new(index_entries, idx);
+		entry->key = bstrdup(key);
+	}
+	da_push_back(index_entries.array[idx].clones, &clone);
+}
+
+static void clone_index_erase(struct source_clone *clone, const char *key)
+{
+	bool found;
+	size_t idx = clone_index_search(key, &found);
+	if (!found)
+		return;
+	struct clone_index_entry *entry = &index_entries.array[idx];
+	da_erase_item(entry->clones, &clone);
+	if (entry->clones.num)
+		return;
+	da_free(entry->clones);
+	bfree(entry->key);
+	da_erase(index_entries, idx);
+	if (!index_entries.num)
+		da_free(index_entries);
+}
+
+void clone_index_update(struct source_clone *clone, int clone_type, const char *target)
+{
+	struct dstr key = {0};
+	clone_index_key(&key, clone_type, target);
+	pthread_mutex_lock(&index_mutex);
+	if (!clone->index_key || strcmp(clone->index_key, key.array) != 0) {
+		if (clone->index_key)
+			clone_index_erase(clone, clone->index_key);
+		clone_index_insert(clone, key.array);
+		bfree(clone->index_key);
+		clone->index_key = bstrdup(key.array);
+	}
+	pthread_mutex_unlock(&index_mutex);
+	dstr_free(&key);
+}
+
+void clone_index_remove(struct source_clone *clone)
+{
+	pthread_mutex_lock(&index_mutex);
+	if (clone->index_key)
+		clone_index_erase(clone, clone->index_key);
+	bfree(clone->index_key);
+	clone->index_key = NULL;
+	pthread_mutex_unlock(&index_mutex);
+}
+
+void clone_index_enum(int clone_type, const char *target, void (*callback)(void *, struct source_clone *), void *param)
+{
+	struct dstr key = {0};
+	clone_index_key(&key, clone_type, target);
+	pthread_mutex_lock(&index_mutex);
+	bool found;
+	size_t idx = clone_index_search(key.array, &found);
+	if (found) {
+		struct clone_index_entry *entry = &index_entries.array[idx];
+		for (size_t i = 0; i < entry->clones.num; i++)
+			callback(param, entry->clones.array[i]);
+	}
+	pthread_mutex_unlock(&index_mutex);
+	dstr_free(&key);
+}
+
+void clone_index_enum_all(void (*callback)(void *, struct source_clone *), void *param)
+{
+	pthread_mutex_lock(&index_mutex);
+	for (size_t i = 0; i < index_entries.num; i++) {
+		struct clone_index_entry *entry = &index_entries.array[i];
+		for (size_t j = 0; j < entry->clones.num; j++)
+			callback(param, entry->clones.array[j]);
+	}
+	pthread_mutex_unlock(&index_mutex);
+}
+
+void clone_index_find(struct source_clone *clone, int clone_type, const char *target, struct dstr *names)
+{
+	struct dstr key = {0};
+	clone_index_key(&key, clone_type, target);
+	pthread_mutex_lock(&index_mutex);
+	bool found;
+	size_t idx = clone_index_search(key.array, &found);
+	if (found) {
+		struct clone_index_entry *entry = &index_entries.array[idx];
+		for (size_t i = 0; i < entry->clones.num; i++) {
+			if (entry->clones.array[i] == clone)
+				continue;
+			if (names->len)
+				dstr_cat(names, "\n");
+			dstr_cat(names, obs_source_get_name(entry->clones.array[i]->source));
+		}
+	}
+	pthread_mutex_unlock(&index_mutex);
+	dstr_free(&key);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <obs.h>
+#include <util/dstr.h>
+
+struct source_clone;
+
+void clone_index_update(struct source_clone *clone, int clone_type, const char *target);
+
+void clone_index_remove(struct source_clone *clone);
+
+void clone_index_enum(int clone_type, const char *target, void (*callback)(void *, struct source_clone *), void *param);
+
+void clone_index_enum_all(void (*callback)(void *, struct source_clone *), void *param);
+
+void clone_index_find(struct source_clone *clone, int clone_type, const char *target, struct dstr *names);
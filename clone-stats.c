@@ -0,0 +1,127 @@
+#include <obs-module.h>
+#include <util/threading.h>
+#include "clone-stats.h"
+#include "clone-index.h"
+#include "source-clone.h"
+
+// counters are written on the graphics thread and read unlocked by the procs, close enough for monitoring
+
+void clone_stats_render(struct source_clone *context, uint64_t elapsed)
+{
+	struct source_clone_stats *stats = &context->stats;
+	stats->renders++;
+	stats->render_time += elapsed;
+	if (elapsed > stats->render_max)
+		stats->render_max = elapsed;
+}
+
+void clone_stats_buffer(struct source_clone *context, uint64_t buffer_frame_time)
+{
+	struct source_clone_stats *stats = &context->stats;
+	if (buffer_frame_time == obs_get_video_frame_time() && buffer_frame_time != stats->buffer_frame_time) {
+		stats->buffer_frame_time = buffer_frame_time;
+		stats->buffer_renders++;
+	} else {
+		stats->skipped_renders++;
+	}
+}
+
+void clone_stats_skip(struct source_clone *context)
+{
+	context->stats.skipped_renders++;
+}
+
+void clone_stats_audio(struct source_clone *context)
+{
+	struct audio_ring *ring = source_clone_audio_ring(context);
+	long queued = ring ? os_atomic_load_long(&ring->queued_frames) : 0;
+	if (queued > context->stats.audio_max_queued)
+		context->stats.audio_max_queued = queued;
+}
+
+static void clone_stats_fill(struct source_clone *context, obs_data_t *data)
+{
+	const struct source_clone_stats *stats = &context->stats;
+	struct audio_ring *ring = source_clone_audio_ring(context);
+	const long queued = ring ? os_atomic_load_long(&ring->queued_frames) : 0;
+	const size_t channels = ring ? ring->channels : 0;
+	const uint32_t sample_rate = ring && ring->sample_rate ? ring->sample_rate : 1;
+
+	obs_data_set_string(data, "name", obs_source_get_name(context->source));
+	obs_data_set_int(data, "renders", (long long)stats->renders);
+	obs_data_set_double(data, "render_time_ms", (double)stats->render_time / 1000000.0);
+	obs_data_set_double(data, "render_avg_us",
+			    stats->renders ? (double)stats->render_time / (double)stats->renders / 1000.0 : 0.0);
+	obs_data_set_double(data, "render_max_us", (double)stats->render_max / 1000.0);
+	obs_data_set_int(data, "buffer_renders", (long long)stats->buffer_renders);
+	obs_data_set_int(data, "skipped_renders", (long long)stats->skipped_renders);
+	obs_data_set_int(data, "audio_queued_frames", queued);
+	obs_data_set_int(data, "audio_queued_bytes", (long long)queued * (long long)channels * sizeof(float));
+	obs_data_set_double(data, "audio_max_latency_ms", (double)stats->audio_max_queued * 1000.0 / sample_rate);
+	obs_data_set_int(data, "audio_dropped_frames", ring ? os_atomic_load_long(&ring->dropped_frames) : 0);
+}
+
+static void clone_stats_proc(void *data, calldata_t *cd)
+{
+	obs_data_t *stats = obs_data_create();
+	clone_stats_fill(data, stats);
+	calldata_set_string(cd, "stats", obs_data_get_json(stats));
+	obs_data_release(stats);
+}
+
+void clone_stats_add_proc(struct source_clone *context)
+{
+	proc_handler_add(obs_source_get_proc_handler(context->source), "void get_stats(out string stats)",
+			 clone_stats_proc, context);
+}
+
+struct clone_stats_total {
+	obs_data_array_t *clones;
+	uint64_t renders;
+	uint64_t render_time;
+	uint64_t buffer_renders;
+	uint64_t skipped_renders;
+	long long audio_dropped_frames;
+};
+
+static void clone_stats_collect(void *param, struct source_clone *context)
+{
+	struct clone_stats_total *total = param;
+	obs_data_t *stats = obs_data_create();
+	clone_stats_fill(context, stats);
+	obs_data_array_push_back(total->clones, stats);
+	obs_data_release(stats);
+	total->renders += context->stats.renders;
+	total->render_time += context->stats.render_time;
+	total->buffer_renders += context->stats.buffer_renders;
+	total->skipped_renders += context->stats.skipped_renders;
+	struct audio_ring *ring = source_clone_audio_ring(context);
+	if (ring)
+		total->audio_dropped_frames += os_atomic_load_long(&ring->dropped_frames);
+}
+
+static void clone_stats_module_proc(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	struct clone_stats_total total = {0};
+	total.clones = obs_data_array_create();
+	clone_index_enum_all(clone_stats_collect, &total);
+
+	obs_data_t *stats = obs_data_create();
+	obs_data_set_int(stats, "clone_count", (long long)obs_data_array_count(total.clones));
+	obs_data_set_int(stats, "renders", (long long)total.renders);
+	obs_data_set_double(stats, "render_time_ms", (double)total.render_time / 1000000.0);
+	obs_data_set_int(stats, "buffer_renders", (long long)total.buffer_renders);
+	obs_data_set_int(stats, "skipped_renders", (long long)total.skipped_renders);
+	obs_data_set_int(stats, "audio_dropped_frames", total.audio_dropped_frames);
+	obs_data_set_array(stats, "clones", total.clones);
+	obs_data_array_release(total.clones);
+	calldata_set_string(cd, "stats", obs_data_get_json(stats));
+	obs_data_release(stats);
+}
+
+void clone_stats_init(void)
+{
+	proc_handler_add(obs_get_proc_handler(), "void source_clone_stats(out string stats)", clone_stats_module_proc,
+			 NULL);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <obs.h>
+
+struct source_clone;
+
+struct source_clone_stats {
+	uint64_t renders;
+	uint64_t render_time;
+	uint64_t render_max;
+	uint64_t buffer_renders;
+	uint64_t skipped_renders;
+	uint64_t buffer_frame_time;
+	long audio_max_queued;
+};
+
+void clone_stats_render(struct source_clone *context, uint64_t elapsed);
+
+void clone_stats_buffer(struct source_clone *context, uint64_t buffer_frame_time);
+
+void clone_stats_skip(struct source_clone *context);
+
+void clone_stats_audio(struct source_clone *context);
+
+void clone_stats_add_proc(struct source_clone *context);
+
+void clone_stats_init(void);
@@ -0,0 +1,190 @@
+#include <obs-module.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "clone-trace.h"
+
+#define CLONE_TRACE_MAX_SECONDS 60
+#define CLONE_TRACE_EVENTS_PER_SECOND 20000
+#define CLONE_TRACE_MAX_EVENTS 1000000
+
+struct clone_trace_event {
+	const char *name;
+	enum clone_trace_thread thread;
+	uint64_t start;
+	uint64_t end;
+};
+
+struct clone_trace_job {
+	char *path;
+	long long seconds;
+};
+
+volatile bool clone_trace_active = false;
+
+// allocated when a trace starts, threads reserve slots with an atomic increment and never wait on each other
+static struct clone_trace_event *trace_events;
+static long trace_capacity;
+static volatile long trace_count;
+static volatile long trace_writers;
+static volatile bool trace_running = false;
+static pthread_t trace_thread;
+static bool trace_thread_valid = false;
+static os_event_t *trace_stop;
+
+uint64_t clone_trace_now(void)
+{
+	return os_gettime_ns();
+}
+
+void clone_trace_record(const char *name, enum clone_trace_thread thread, uint64_t start)
+{
+	const uint64_t end = os_gettime_ns();
+	// the trace thread waits for writers to leave before it takes the events
+	os_atomic_inc_long(&trace_writers);
+	if (os_atomic_load_bool(&clone_trace_active)) {
+		long idx = os_atomic_inc_long(&trace_count) - 1;
+		if (idx < trace_capacity) {
+			struct clone_trace_event *event = &trace_events[idx];
+			event->name = name;
+			event->thread = thread;
+			event->start = start;
+			event->end = end;
+		}
+	}
+	os_atomic_dec_long(&trace_writers);
+}
+
+const char *clone_trace_name(const char *format, const char *source_name)
+{
+	// stored names live as long as the profiler, like the ones libobs makes for sources
+	return profile_store_name(obs_get_profiler_name_store(), format, source_name ? source_name : "");
+}
+
+static void clone_trace_write_string(struct dstr *json, const char *str)
+{
+	dstr_cat_ch(json, '"');
+	for (const char *c = str; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			dstr_cat_ch(json, '\\');
+			dstr_cat_ch(json, *c);
+		} else if ((unsigned char)*c < 0x20) {
+			dstr_catf(json, "\\u%04x", (unsigned char)*c);
+		} else {
+			dstr_cat_ch(json, *c);
+		}
+	}
+	dstr_cat_ch(json, '"');
+}
+
+static const char *clone_trace_thread_names[] = {
+	"",
+	"video",
+	"audio",
+	"audio forward",
+};
+
+static bool clone_trace_write(const char *path, const struct clone_trace_event *events, size_t count)
+{
+	struct dstr json = {0};
+	dstr_copy(&json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (int thread = CLONE_TRACE_VIDEO; thread <= CLONE_TRACE_FORWARD; thread++) {
+		dstr_catf(&json,
+			  "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},",
+			  thread, clone_trace_thread_names[thread]);
+	}
+	for (size_t i = 0; i < count; i++) {
+		const struct clone_trace_event *event = &events[i];
+		dstr_cat(&json, "{\"name\":");
+		clone_trace_write_string(&json, event->name);
+		dstr_catf(&json, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},", (int)event->thread,
+			  (double)event->start / 1000.0, (double)(event->end - event->start) / 1000.0);
+	}
+	if (dstr_end(&json) == ',')
+		dstr_resize(&json, json.len - 1);
+	dstr_cat(&json, "]}");
+	bool success = os_quick_write_utf8_file(path, json.array, json.len, false);
+	dstr_free(&json);
+	return success;
+}
+
+static void *clone_trace_thread_func(void *data)
+{
+	struct clone_trace_job *job = data;
+	os_set_thread_name("source-clone: trace");
+	// cut short when the module unloads
+	os_event_timedwait(trace_stop, (unsigned long)job->seconds * 1000);
+
+	os_atomic_set_bool(&clone_trace_active, false);
+	while (os_atomic_load_long(&trace_writers))
+		os_sleep_ms(1);
+	struct clone_trace_event *events = trace_events;
+	long count = os_atomic_load_long(&trace_count);
+	if (count > trace_capacity)
+		count = trace_capacity;
+	trace_events = NULL;
+
+	if (clone_trace_write(job->path, events, (size_t)count))
+		blog(LOG_INFO, "[Source Clone] wrote %ld trace events to '%s'", count, job->path);
+	else
+		blog(LOG_WARNING, "[Source Clone] failed to write trace to '%s'", job->path);
+	bfree(events);
+	bfree(job->path);
+	bfree(job);
+	os_atomic_set_bool(&trace_running, false);
+	return NULL;
+}
+
+static void clone_trace_proc(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	const char *path = calldata_string(cd, "path");
+	long long seconds = calldata_int(cd, "seconds");
+	if (!trace_stop || !path || !*path || seconds < 1 || seconds > CLONE_TRACE_MAX_SECONDS ||
+	    !os_atomic_compare_swap_bool(&trace_running, false, true)) {
+		calldata_set_bool(cd, "success", false);
+		return;
+	}
+	if (trace_thread_valid)
+		pthread_join(trace_thread, NULL);
+
+	struct clone_trace_job *job = bzalloc(sizeof(struct clone_trace_job));
+	job->path = bstrdup(path);
+	job->seconds = seconds;
+	trace_capacity = (long)seconds * CLONE_TRACE_EVENTS_PER_SECOND;
+	if (trace_capacity > CLONE_TRACE_MAX_EVENTS)
+		trace_capacity = CLONE_TRACE_MAX_EVENTS;
+	trace_events = bmalloc((size_t)trace_capacity * sizeof(struct clone_trace_event));
+	os_atomic_set_long(&trace_count, 0);
+	os_atomic_set_bool(&clone_trace_active, true);
+	trace_thread_valid = pthread_create(&trace_thread, NULL, clone_trace_thread_func, job) == 0;
+	if (!trace_thread_valid) {
+		os_atomic_set_bool(&clone_trace_active, false);
+		while (os_atomic_load_long(&trace_writers))
+			os_sleep_ms(1);
+		bfree(trace_events);
+		trace_events = NULL;
+		os_atomic_set_bool(&trace_running, false);
+		bfree(job->path);
+		bfree(job);
+	}
+	calldata_set_bool(cd, "success", trace_thread_valid);
+}
+
+void clone_trace_init(void)
+{
+	os_event_init(&trace_stop, OS_EVENT_TYPE_MANUAL);
+	proc_handler_add(obs_get_proc_handler(),
+			 "void source_clone_trace(in int seconds, in string path, out bool success)", clone_trace_proc,
+			 NULL);
+}
+
+void clone_trace_free(void)
+{
+	os_event_signal(trace_stop);
+	if (trace_thread_valid)
+		pthread_join(trace_thread, NULL);
+	trace_thread_valid = false;
+	os_event_destroy(trace_stop);
+	trace_stop = NULL;
+}
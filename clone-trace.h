@@ -0,0 +1,44 @@
+#pragma once
+#include <obs.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+
+enum clone_trace_thread {
+	CLONE_TRACE_VIDEO = 1,
+	CLONE_TRACE_AUDIO,
+	CLONE_TRACE_FORWARD,
+};
+
+struct clone_scope {
+	const char *name;
+	enum clone_trace_thread thread;
+	uint64_t start;
+};
+
+extern volatile bool clone_trace_active;
+
+uint64_t clone_trace_now(void);
+
+void clone_trace_record(const char *name, enum clone_trace_thread thread, uint64_t start);
+
+// a libobs profiler scope that is also captured by a running trace
+static inline void clone_scope_start(struct clone_scope *scope, const char *name, enum clone_trace_thread thread)
+{
+	profile_start(name);
+	scope->name = name;
+	scope->thread = thread;
+	scope->start = os_atomic_load_bool(&clone_trace_active) ? clone_trace_now() : 0;
+}
+
+static inline void clone_scope_end(struct clone_scope *scope)
+{
+	profile_end(scope->name);
+	if (scope->start)
+		clone_trace_record(scope->name, scope->thread, scope->start);
+}
+
+const char *clone_trace_name(const char *format, const char *source_name);
+
+void clone_trace_init(void);
+
+void clone_trace_free(void);
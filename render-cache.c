@@ -0,0 +1,199 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include "render-cache.h"
+#include "render-pool.h"
+
+#define RENDER_CACHE_STATIC_REFRESH 1000000000ULL
+
+struct render_cache {
+	obs_weak_source_t *source;
+	bool no_filter;
+	enum gs_color_space space;
+	enum gs_color_format format;
+	uint32_t cx;
+	uint32_t cy;
+	bool exact;
+	struct render_crop crop;
+	gs_texrender_t *render;
+	uint32_t pool_cx;
+	uint32_t pool_cy;
+	uint64_t frame_time;
+	bool rendered;
+	bool rendering;
+	bool static_content;
+	volatile long changed;
+	long refs;
+};
+
+static const char *static_source_ids[] = {
+	"color_source", "text_ft2_source", "text_gdiplus", "image_source",
+};
+
+static const char *render_cache_signals[] = {
+	"update",
+	"filter_add",
+	"filter_remove",
+};
+
+// only touched from the graphics thread or inside obs_enter_graphics
+static DARRAY(struct render_cache *) render_caches;
+
+static void render_cache_changed(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(cd);
+	struct render_cache *rc = data;
+	// deferred video updates land in the next tick, so render the following frame as well
+	os_atomic_set_long(&rc->changed, 2);
+}
+
+static bool render_cache_is_static(obs_source_t *source, bool no_filter)
+{
+	if ((obs_source_get_output_flags(source) & OBS_SOURCE_ASYNC) != 0)
+		return false;
+	if (!no_filter && obs_source_filter_count(source) > 0)
+		return false;
+	const char *id = obs_source_get_unversioned_id(source);
+	if (!id)
+		return false;
+	bool known = false;
+	for (size_t i = 0; i < OBS_COUNTOF(static_source_ids); i++) {
+		if (strcmp(id, static_source_ids[i]) == 0) {
+			known = true;
+			break;
+		}
+	}
+	if (!known || strcmp(id, "image_source") != 0)
+		return known;
+	// animated images advance in their own tick
+	obs_data_t *settings = obs_source_get_settings(source);
+	const char *file = obs_data_get_string(settings, "file");
+	size_t len = file ? strlen(file) : 0;
+	bool animated = len >= 4 && astrcmpi(file + len - 4, ".gif") == 0;
+	obs_data_release(settings);
+	return !animated;
+}
+
+bool render_cache_matches(struct render_cache *rc, obs_source_t *source, bool no_filter, enum gs_color_space space,
+			  enum gs_color_format format, uint32_t cx, uint32_t cy, bool exact,
+			  const struct render_crop *crop)
+{
+	return rc && rc->no_filter == no_filter && rc->space == space && rc->format == format && rc->cx == cx &&
+	       rc->cy == cy && rc->exact == exact &&
+	       memcmp(&rc->crop, crop, sizeof(struct render_crop)) == 0 &&
+	       obs_weak_source_references_source(rc->source, source);
+}
+
+struct render_cache *render_cache_acquire(obs_source_t *source, bool no_filter, enum gs_color_space space,
+					  enum gs_color_format format, uint32_t cx, uint32_t cy, bool exact,
+					  const struct render_crop *crop)
+{
+	for (size_t i = 0; i < render_caches.num; i++) {
+		struct render_cache *rc = render_caches.array[i];
+		if (render_cache_matches(rc, source, no_filter, space, format, cx, cy, exact, crop)) {
+			rc->refs++;
+			return rc;
+		}
+	}
+	struct render_cache *rc = bzalloc(sizeof(struct render_cache));
+	rc->source = obs_source_get_weak_source(source);
+	rc->no_filter = no_filter;
+	rc->space = space;
+	rc->format = format;
+	rc->cx = cx;
+	rc->cy = cy;
+	rc->exact = exact;
+	rc->crop = *crop;
+	rc->refs = 1;
+	rc->changed = 2;
+	signal_handler_t *sh = obs_source_get_signal_handler(source);
+	for (size_t i = 0; i < OBS_COUNTOF(render_cache_signals); i++)
+		signal_handler_connect(sh, render_cache_signals[i], render_cache_changed, rc);
+	da_push_back(render_caches, &rc);
+	return rc;
+}
+
+void render_cache_release(struct render_cache *rc)
+{
+	if (!rc || --rc->refs > 0)
+		return;
+	da_erase_item(render_caches, &rc);
+	render_pool_return(rc->render, rc->pool_cx, rc->pool_cy);
+	if (!render_caches.num)
+		da_free(render_caches);
+	obs_source_t *source = obs_weak_source_get_source(rc->source);
+	if (source) {
+		signal_handler_t *sh = obs_source_get_signal_handler(source);
+		for (size_t i = 0; i < OBS_COUNTOF(render_cache_signals); i++)
+			signal_handler_disconnect(sh, render_cache_signals[i], render_cache_changed, rc);
+		obs_source_release(source);
+	}
+	obs_weak_source_release(rc->source);
+	bfree(rc);
+}
+
+bool render_cache_render(struct render_cache *rc, obs_source_t *source, uint32_t source_cx, uint32_t source_cy,
+			 uint64_t interval, bool skip_unchanged)
+{
+	// a clone nested inside the target it is filling would sample the texture while it is bound as the target
+	if (rc->rendering)
+		return false;
+	const uint64_t frame_time = obs_get_video_frame_time();
+	if (rc->rendered && rc->frame_time == frame_time)
+		return true;
+	// half a frame of slack so output frame jitter does not skip an extra frame
+	if (rc->rendered && interval && frame_time - rc->frame_time + obs_get_frame_interval_ns() / 2 < interval)
+		return true;
+	long changed = os_atomic_load_long(&rc->changed);
+	if (changed > 0) {
+		os_atomic_compare_swap_long(&rc->changed, changed, changed - 1);
+		rc->static_content = render_cache_is_static(source, rc->no_filter);
+	} else if (skip_unchanged && rc->rendered && rc->static_content &&
+		   frame_time - rc->frame_time < RENDER_CACHE_STATIC_REFRESH) {
+		// static content that may still reload from disk gets refreshed once per second
+		return true;
+	}
+	rc->rendering = true;
+
+	if (!rc->render)
+		rc->render = render_pool_borrow(rc->format, rc->cx, rc->cy, rc->exact, &rc->pool_cx, &rc->pool_cy);
+	else
+		gs_texrender_reset(rc->render);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	if (gs_texrender_begin_with_color_space(rc->render, rc->pool_cx, rc->pool_cy, rc->space)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_set_viewport(0, 0, (int)rc->cx, (int)rc->cy);
+		// only the cropped region falls inside the projection, the rest is clipped before fill
+		const float left = (float)rc->crop.left;
+		const float top = (float)rc->crop.top;
+		gs_ortho(left, left + (float)source_cx, top, top + (float)source_cy, -100.0f, 100.0f);
+		if (rc->no_filter) {
+			obs_source_default_render(source);
+		} else {
+			obs_source_video_render(source);
+		}
+		gs_texrender_end(rc->render);
+		rc->rendered = true;
+	}
+	gs_blend_state_pop();
+
+	rc->frame_time = frame_time;
+	rc->rendering = false;
+	return rc->rendered;
+}
+
+uint64_t render_cache_get_frame_time(struct render_cache *rc)
+{
+	return rc ? rc->frame_time : 0;
+}
+
+gs_texture_t *render_cache_get_texture(struct render_cache *rc)
+{
+	return rc && rc->render ? gs_texrender_get_texture(rc->render) : NULL;
+}
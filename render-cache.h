@@ -0,0 +1,30 @@
+#pragma once
+#include <obs.h>
+
+struct render_cache;
+
+struct render_crop {
+	uint32_t left;
+	uint32_t top;
+	uint32_t right;
+	uint32_t bottom;
+};
+
+// exact is for buffers drawn scaled, the others may render into the top left of a larger pooled target
+struct render_cache *render_cache_acquire(obs_source_t *source, bool no_filter, enum gs_color_space space,
+					  enum gs_color_format format, uint32_t cx, uint32_t cy, bool exact,
+					  const struct render_crop *crop);
+
+void render_cache_release(struct render_cache *rc);
+
+bool render_cache_matches(struct render_cache *rc, obs_source_t *source, bool no_filter, enum gs_color_space space,
+			  enum gs_color_format format, uint32_t cx, uint32_t cy, bool exact,
+			  const struct render_crop *crop);
+
+// source_cx and source_cy are the size of the region left after cropping
+bool render_cache_render(struct render_cache *rc, obs_source_t *source, uint32_t source_cx, uint32_t source_cy,
+			 uint64_t interval, bool skip_unchanged);
+
+uint64_t render_cache_get_frame_time(struct render_cache *rc);
+
+gs_texture_t *render_cache_get_texture(struct render_cache *rc);
@@ -0,0 +1,125 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include "render-pool.h"
+
+#define RENDER_POOL_MIN_CLASS 64
+#define RENDER_POOL_EXPIRE 2000000000ULL
+
+struct render_pool_item {
+	gs_texrender_t *render;
+	enum gs_color_format format;
+	uint32_t cx;
+	uint32_t cy;
+	uint64_t last_used;
+};
+
+static DARRAY(struct render_pool_item) render_pool;
+static uint64_t render_pool_last_tick;
+
+static uint32_t render_pool_size_class(uint32_t size)
+{
+	uint32_t pow2 = RENDER_POOL_MIN_CLASS;
+	while (pow2 < size)
+		pow2 <<= 1;
+	uint32_t step = pow2 / 8;
+	if (step < RENDER_POOL_MIN_CLASS)
+		step = RENDER_POOL_MIN_CLASS;
+	return (size + step - 1) / step * step;
+}
+
+static bool render_pool_has_expired(uint64_t now)
+{
+	for (size_t i = 0; i < render_pool.num; i++) {
+		if (now - render_pool.array[i].last_used >= RENDER_POOL_EXPIRE)
+			return true;
+	}
+	return false;
+}
+
+static void render_pool_expire(uint64_t now)
+{
+	for (size_t i = render_pool.num; i > 0; i--) {
+		struct render_pool_item *item = &render_pool.array[i - 1];
+		if (now - item->last_used < RENDER_POOL_EXPIRE)
+			continue;
+		gs_texrender_destroy(item->render);
+		da_erase(render_pool, i - 1);
+	}
+	if (!render_pool.num)
+		da_free(render_pool);
+}
+
+gs_texrender_t *render_pool_borrow(enum gs_color_format format, uint32_t cx, uint32_t cy, bool exact,
+				   uint32_t *pool_cx, uint32_t *pool_cy)
+{
+	uint32_t class_cx = exact ? cx : render_pool_size_class(cx);
+	uint32_t class_cy = exact ? cy : render_pool_size_class(cy);
+	uint64_t class_area = (uint64_t)class_cx * class_cy;
+
+	size_t best = DARRAY_INVALID;
+	uint64_t best_area = 0;
+	for (size_t i = 0; i < render_pool.num; i++) {
+		struct render_pool_item *item = &render_pool.array[i];
+		if (item->format != format || item->cx < class_cx || item->cy < class_cy)
+			continue;
+		if (exact && (item->cx != cx || item->cy != cy))
+			continue;
+		uint64_t area = (uint64_t)item->cx * item->cy;
+		// reuse a larger target instead of allocating on shrink, within twice the needed area
+		if (area > class_area * 2)
+			continue;
+		if (best == DARRAY_INVALID || area < best_area) {
+			best = i;
+			best_area = area;
+		}
+	}
+
+	gs_texrender_t *render;
+	if (best != DARRAY_INVALID) {
+		struct render_pool_item *item = &render_pool.array[best];
+		render = item->render;
+		*pool_cx = item->cx;
+		*pool_cy = item->cy;
+		da_erase(render_pool, best);
+		gs_texrender_reset(render);
+	} else {
+		render = gs_texrender_create(format, GS_ZS_NONE);
+		*pool_cx = class_cx;
+		*pool_cy = class_cy;
+	}
+	render_pool_expire(obs_get_video_frame_time());
+	return render;
+}
+
+void render_pool_return(gs_texrender_t *render, uint32_t pool_cx, uint32_t pool_cy)
+{
+	if (!render)
+		return;
+	struct render_pool_item *item = da_push_back_new(render_pool);
+	item->render = render;
+	item->format = gs_texrender_get_format(render);
+	item->cx = pool_cx;
+	item->cy = pool_cy;
+	item->last_used = obs_get_video_frame_time();
+	render_pool_expire(item->last_used);
+}
+
+void render_pool_tick(void)
+{
+	const uint64_t now = obs_get_video_frame_time();
+	if (now == render_pool_last_tick)
+		return;
+	render_pool_last_tick = now;
+	if (!render_pool_has_expired(now))
+		return;
+	obs_enter_graphics();
+	render_pool_expire(now);
+	obs_leave_graphics();
+}
+
+void render_pool_free(void)
+{
+	for (size_t i = 0; i < render_pool.num; i++)
+		gs_texrender_destroy(render_pool.array[i].render);
+	da_free(render_pool);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <obs.h>
+
+// targets come in size classes and may be larger than asked for, the extra area is only safe to leave
+// undrawn at 1:1, scaled draws sample past the edge and need an exact target
+gs_texrender_t *render_pool_borrow(enum gs_color_format format, uint32_t cx, uint32_t cy, bool exact,
+				   uint32_t *pool_cx, uint32_t *pool_cy);
+
+void render_pool_return(gs_texrender_t *render, uint32_t pool_cx, uint32_t pool_cy);
+
+// drops targets nobody borrowed for a while, cheap to call from every clone's tick
+void render_pool_tick(void);
+
+void render_pool_free(void);
@@ -0,0 +1,160 @@
+#include <obs-module.h>
+#include <obs-frontend-api.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "scene-tracker.h"
+
+struct scene_tracker {
+	obs_weak_canvas_t *canvas;
+	obs_weak_source_t *scene;
+	volatile bool dirty;
+	long generation;
+	long refs;
+};
+
+static pthread_mutex_t trackers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct scene_tracker *) trackers;
+
+static const char *tracker_signals[] = {
+	"channel_change",
+	"source_transition_start",
+	"source_transition_stop",
+};
+
+static void scene_tracker_invalidate(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(cd);
+	struct scene_tracker *tracker = data;
+	if (tracker)
+		os_atomic_set_bool(&tracker->dirty, true);
+	else
+		scene_tracker_invalidate_all();
+}
+
+void scene_tracker_invalidate_all(void)
+{
+	pthread_mutex_lock(&trackers_mutex);
+	for (size_t i = 0; i < trackers.num; i++)
+		os_atomic_set_bool(&trackers.array[i]->dirty, true);
+	pthread_mutex_unlock(&trackers_mutex);
+}
+
+bool scene_tracker_uses(struct scene_tracker *tracker, obs_canvas_t *canvas)
+{
+	if (!tracker)
+		return false;
+	if (!canvas)
+		return !tracker->canvas;
+	if (!tracker->canvas)
+		return false;
+	obs_canvas_t *tracked = obs_weak_canvas_get_canvas(tracker->canvas);
+	obs_canvas_release(tracked);
+	return tracked == canvas;
+}
+
+struct scene_tracker *scene_tracker_acquire(obs_canvas_t *canvas)
+{
+	pthread_mutex_lock(&trackers_mutex);
+	for (size_t i = 0; i < trackers.num; i++) {
+		struct scene_tracker *tracker = trackers.array[i];
+		if (scene_tracker_uses(tracker, canvas)) {
+			tracker->refs++;
+			pthread_mutex_unlock(&trackers_mutex);
+			return tracker;
+		}
+	}
+	struct scene_tracker *tracker = bzalloc(sizeof(struct scene_tracker));
+	tracker->canvas = canvas ? obs_canvas_get_weak_canvas(canvas) : NULL;
+	tracker->dirty = true;
+	tracker->refs = 1;
+	if (canvas)
+		signal_handler_connect(obs_canvas_get_signal_handler(canvas), "channel_change",
+				       scene_tracker_invalidate, tracker);
+	da_push_back(trackers, &tracker);
+	pthread_mutex_unlock(&trackers_mutex);
+	return tracker;
+}
+
+void scene_tracker_release(struct scene_tracker *tracker)
+{
+	if (!tracker)
+		return;
+	pthread_mutex_lock(&trackers_mutex);
+	if (--tracker->refs > 0) {
+		pthread_mutex_unlock(&trackers_mutex);
+		return;
+	}
+	da_erase_item(trackers, &tracker);
+	if (!trackers.num)
+		da_free(trackers);
+	pthread_mutex_unlock(&trackers_mutex);
+
+	obs_canvas_t *canvas = obs_weak_canvas_get_canvas(tracker->canvas);
+	if (canvas) {
+		signal_handler_disconnect(obs_canvas_get_signal_handler(canvas), "channel_change",
+					  scene_tracker_invalidate, tracker);
+		obs_canvas_release(canvas);
+	}
+	obs_weak_canvas_release(tracker->canvas);
+	obs_weak_source_release(tracker->scene);
+	bfree(tracker);
+}
+
+static obs_source_t *scene_tracker_find_scene(struct scene_tracker *tracker)
+{
+	if (!tracker->canvas)
+		return obs_frontend_get_current_scene();
+
+	obs_canvas_t *canvas = obs_weak_canvas_get_canvas(tracker->canvas);
+	if (!canvas)
+		return NULL;
+	obs_source_t *source = obs_canvas_get_channel(canvas, 0);
+	while (source && obs_source_get_type(source) == OBS_SOURCE_TYPE_TRANSITION) {
+		obs_source_t *ts = obs_transition_get_active_source(source);
+		if (ts) {
+			obs_source_release(source);
+			source = ts;
+		} else {
+			break;
+		}
+	}
+	obs_canvas_release(canvas);
+	return source;
+}
+
+void scene_tracker_update(struct scene_tracker *tracker)
+{
+	if (!os_atomic_exchange_bool(&tracker->dirty, false))
+		return;
+	obs_source_t *source = scene_tracker_find_scene(tracker);
+	if (source ? !obs_weak_source_references_source(tracker->scene, source) : tracker->scene != NULL) {
+		obs_weak_source_release(tracker->scene);
+		tracker->scene = obs_source_get_weak_source(source);
+		tracker->generation++;
+	}
+	obs_source_release(source);
+}
+
+long scene_tracker_generation(struct scene_tracker *tracker)
+{
+	return tracker->generation;
+}
+
+obs_source_t *scene_tracker_get_scene(struct scene_tracker *tracker)
+{
+	return obs_weak_source_get_source(tracker->scene);
+}
+
+void scene_tracker_init(void)
+{
+	signal_handler_t *sh = obs_get_signal_handler();
+	for (size_t i = 0; i < OBS_COUNTOF(tracker_signals); i++)
+		signal_handler_connect(sh, tracker_signals[i], scene_tracker_invalidate, NULL);
+}
+
+void scene_tracker_free(void)
+{
+	signal_handler_t *sh = obs_get_signal_handler();
+	for (size_t i = 0; i < OBS_COUNTOF(tracker_signals); i++)
+		signal_handler_disconnect(sh, tracker_signals[i], scene_tracker_invalidate, NULL);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <obs.h>
+
+struct scene_tracker;
+
+struct scene_tracker *scene_tracker_acquire(obs_canvas_t *canvas);
+
+void scene_tracker_release(struct scene_tracker *tracker);
+
+bool scene_tracker_uses(struct scene_tracker *tracker, obs_canvas_t *canvas);
+
+void scene_tracker_update(struct scene_tracker *tracker);
+
+long scene_tracker_generation(struct scene_tracker *tracker);
+
+obs_source_t *scene_tracker_get_scene(struct scene_tracker *tracker);
+
+void scene_tracker_invalidate_all(void);
+
+void scene_tracker_init(void);
+
+void scene_tracker_free(void);
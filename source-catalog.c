@@ -0,0 +1,181 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "source-catalog.h"
+
+struct catalog_canvas {
+	char *name;
+	bool main;
+	DARRAY(char *) scenes;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	volatile bool dirty;
+	DARRAY(char *) sources;
+	DARRAY(char *) all_scenes;
+	DARRAY(struct catalog_canvas) canvases;
+} catalog = {.mutex = PTHREAD_MUTEX_INITIALIZER, .dirty = true};
+
+static const char *catalog_signals[] = {
+	"source_create", "source_destroy", "source_rename", "channel_change",
+	"canvas_create", "canvas_destroy", "canvas_rename",
+};
+
+static int catalog_compare(const void *a, const void *b)
+{
+	return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static void catalog_free_names(char **names, size_t num)
+{
+	for (size_t i = 0; i < num; i++)
+		bfree(names[i]);
+}
+
+static void catalog_clear(void)
+{
+	catalog_free_names(catalog.sources.array, catalog.sources.num);
+	da_free(catalog.sources);
+	catalog_free_names(catalog.all_scenes.array, catalog.all_scenes.num);
+	da_free(catalog.all_scenes);
+	for (size_t i = 0; i < catalog.canvases.num; i++) {
+		struct catalog_canvas *canvas = &catalog.canvases.array[i];
+		bfree(canvas->name);
+		catalog_free_names(canvas->scenes.array, canvas->scenes.num);
+		da_free(canvas->scenes);
+	}
+	da_free(catalog.canvases);
+}
+
+static bool catalog_add_source(void *data, obs_source_t *source)
+{
+	UNUSED_PARAMETER(data);
+	char *name = bstrdup(obs_source_get_name(source));
+	da_push_back(catalog.sources, &name);
+	return true;
+}
+
+static bool catalog_add_scene(void *data, obs_source_t *source)
+{
+	struct catalog_canvas *canvas = data;
+	char *name = bstrdup(obs_source_get_name(source));
+	da_push_back(canvas->scenes, &name);
+	name = bstrdup(name);
+	da_push_back(catalog.all_scenes, &name);
+	return true;
+}
+
+static bool catalog_add_canvas(void *data, obs_canvas_t *canvas)
+{
+	obs_canvas_t *main_canvas = data;
+	struct catalog_canvas *cc = da_push_back_new(catalog.canvases);
+	cc->name = bstrdup(obs_canvas_get_name(canvas));
+	cc->main = canvas == main_canvas;
+	obs_canvas_enum_scenes(canvas, catalog_add_scene, cc);
+	qsort(cc->scenes.array, cc->scenes.num, sizeof(char *), catalog_compare);
+	return true;
+}
+
+static int catalog_compare_canvas(const void *a, const void *b)
+{
+	return strcmp(((const struct catalog_canvas *)a)->name, ((const struct catalog_canvas *)b)->name);
+}
+
+static void catalog_build(void)
+{
+	if (!os_atomic_exchange_bool(&catalog.dirty, false))
+		return;
+	catalog_clear();
+	obs_enum_sources(catalog_add_source, NULL);
+	//add global audio sources
+	for (uint32_t i = 1; i < 7; i++) {
+		obs_source_t *s = obs_get_output_source(i);
+		if (!s)
+			continue;
+		catalog_add_source(NULL, s);
+		obs_source_release(s);
+	}
+	qsort(catalog.sources.array, catalog.sources.num, sizeof(char *), catalog_compare);
+
+	obs_canvas_t *main_canvas = obs_get_main_canvas();
+	obs_enum_canvases(catalog_add_canvas, main_canvas);
+	obs_canvas_release(main_canvas);
+	qsort(catalog.all_scenes.array, catalog.all_scenes.num, sizeof(char *), catalog_compare);
+	qsort(catalog.canvases.array, catalog.canvases.num, sizeof(struct catalog_canvas), catalog_compare_canvas);
+}
+
+static void catalog_invalidate(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(cd);
+	os_atomic_set_bool(&catalog.dirty, true);
+}
+
+void source_catalog_init(void)
+{
+	signal_handler_t *sh = obs_get_signal_handler();
+	for (size_t i = 0; i < OBS_COUNTOF(catalog_signals); i++)
+		signal_handler_connect(sh, catalog_signals[i], catalog_invalidate, NULL);
+}
+
+void source_catalog_free(void)
+{
+	signal_handler_t *sh = obs_get_signal_handler();
+	for (size_t i = 0; i < OBS_COUNTOF(catalog_signals); i++)
+		signal_handler_disconnect(sh, catalog_signals[i], catalog_invalidate, NULL);
+	pthread_mutex_lock(&catalog.mutex);
+	catalog_clear();
+	os_atomic_set_bool(&catalog.dirty, true);
+	pthread_mutex_unlock(&catalog.mutex);
+}
+
+void source_catalog_fill_canvases(obs_property_t *prop)
+{
+	pthread_mutex_lock(&catalog.mutex);
+	catalog_build();
+	obs_property_list_add_string(prop, "", "");
+	for (size_t i = 0; i < catalog.canvases.num; i++)
+		obs_property_list_add_string(prop, catalog.canvases.array[i].name, catalog.canvases.array[i].name);
+	pthread_mutex_unlock(&catalog.mutex);
+}
+
+void source_catalog_fill_sources(obs_property_t *prop, const char *canvas_name, bool all_canvases)
+{
+	pthread_mutex_lock(&catalog.mutex);
+	catalog_build();
+	char **scenes = NULL;
+	size_t num_scenes = 0;
+	if (all_canvases) {
+		scenes = catalog.all_scenes.array;
+		num_scenes = catalog.all_scenes.num;
+	} else {
+		struct catalog_canvas *found = NULL;
+		for (size_t i = 0; i < catalog.canvases.num; i++) {
+			struct catalog_canvas *canvas = &catalog.canvases.array[i];
+			if (canvas_name && strcmp(canvas->name, canvas_name) == 0) {
+				found = canvas;
+				break;
+			}
+			if (canvas->main && !found)
+				found = canvas;
+		}
+		if (found) {
+			scenes = found->scenes.array;
+			num_scenes = found->scenes.num;
+		}
+	}
+
+	obs_property_list_add_string(prop, "", "");
+	size_t s = 0;
+	size_t c = 0;
+	while (s < catalog.sources.num || c < num_scenes) {
+		const char *name;
+		if (c >= num_scenes || (s < catalog.sources.num && strcmp(catalog.sources.array[s], scenes[c]) <= 0))
+			name = catalog.sources.array[s++];
+		else
+			name = scenes[c++];
+		obs_property_list_add_string(prop, name, name);
+	}
+	pthread_mutex_unlock(&catalog.mutex);
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <obs.h>
+
+void source_catalog_init(void);
+
+void source_catalog_free(void);
+
+void source_catalog_fill_canvases(obs_property_t *prop);
+
+void source_catalog_fill_sources(obs_property_t *prop, const char *canvas_name, bool all_canvases);
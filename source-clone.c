@@ -1,8 +1,50 @@
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 #include "util/dstr.h"
+#include "util/threading.h"
+#include "util/platform.h"
+#include "util/util_uint64.h"
 #include "source-clone.h"
 #include "audio-wrapper.h"
+#include "render-cache.h"
+#include "render-pool.h"
+#include "audio-forward.h"
+#include "clone-index.h"
+#include "source-catalog.h"
+#include "scene-tracker.h"
+#include "clone-trace.h"
+#include "clone-graph.h"
+
+static struct {
+	pthread_mutex_t mutex;
+	volatile bool loading;
+	volatile bool resolve;
+	DARRAY(struct source_clone *) pending;
+} clone_loader = {.mutex = PTHREAD_MUTEX_INITIALIZER, .loading = true};
+
+static volatile long clone_count = 0;
+
+static void source_clone_defer_resolve(struct source_clone *context)
+{
+	pthread_mutex_lock(&clone_loader.mutex);
+	if (!context->pending_resolve) {
+		context->pending_resolve = true;
+		da_push_back(clone_loader.pending, &context);
+	}
+	pthread_mutex_unlock(&clone_loader.mutex);
+}
+
+static void source_clone_cancel_resolve(struct source_clone *context)
+{
+	pthread_mutex_lock(&clone_loader.mutex);
+	if (context->pending_resolve) {
+		context->pending_resolve = false;
+		da_erase_item(clone_loader.pending, &context);
+		if (!clone_loader.pending.num)
+			da_free(clone_loader.pending);
+	}
+	pthread_mutex_unlock(&clone_loader.mutex);
+}
 
 const char *source_clone_get_name(void *type_data)
 {
@@ -33,14 +75,18 @@ void source_clone_audio_callback(void *data, obs_source_t *source, const struct
 	UNUSED_PARAMETER(muted);
 	UNUSED_PARAMETER(source);
 	struct source_clone *context = data;
-	pthread_mutex_lock(&context->audio_mutex);
-	size_t size = audio_data->frames * sizeof(float);
-	for (size_t i = 0; i < context->num_channels; i++) {
-		deque_push_back(&context->audio_data[i], audio_data->data[i], size);
-	}
-	deque_push_back(&context->audio_frames, &audio_data->frames, sizeof(audio_data->frames));
-	deque_push_back(&context->audio_timestamps, &audio_data->timestamp, sizeof(audio_data->timestamp));
-	pthread_mutex_unlock(&context->audio_mutex);
+	struct audio_ring *ring = source_clone_audio_ring(context);
+	if (!ring)
+		return;
+	audio_ring_push(ring, (const uint8_t *const *)audio_data->data, audio_data->frames, audio_data->timestamp);
+	if (context->audio_low_latency)
+		audio_forward_signal();
+}
+
+// an idle clone keeps showing itself but has dropped the showing reference on its target
+static inline bool source_clone_target_showing(struct source_clone *context)
+{
+	return obs_source_showing(context->source) && !context->idle;
 }
 
 static void source_clone_remove(void *data, calldata_t *cd)
@@ -57,7 +103,7 @@ static void source_clone_remove(void *data, calldata_t *cd)
 		signal_handler_disconnect(sh, "audio_activate", source_clone_audio_activate, data);
 		signal_handler_disconnect(sh, "audio_deactivate", source_clone_audio_deactivate, data);
 		obs_source_remove_audio_capture_callback(source, source_clone_audio_callback, data);
-		if (obs_source_showing(context->source))
+		if (source_clone_target_showing(context))
 			obs_source_dec_showing(source);
 		if (context->active_clone && obs_source_active(context->source))
 			obs_source_dec_active(source);
@@ -67,6 +113,53 @@ static void source_clone_remove(void *data, calldata_t *cd)
 	context->clone = NULL;
 	obs_weak_source_release(context->current_scene);
 	context->current_scene = NULL;
+	obs_weak_source_release(context->frozen_scene);
+	context->frozen_scene = NULL;
+}
+
+static void source_clone_publish_config(struct source_clone *context, struct clone_config *config)
+{
+	struct clone_config *old = (struct clone_config *)context->config;
+	clone_atomic_store_ptr((void *volatile *)&context->config, config);
+	// other threads (get_width, save, stats) may still hold the old config, free it a frame later
+	if (old)
+		da_push_back(context->retired_configs, &old);
+}
+
+static void source_clone_reclaim_configs(struct source_clone *context)
+{
+	for (size_t i = 0; i < context->expired_configs.num; i++)
+		bfree(context->expired_configs.array[i]);
+	da_free(context->expired_configs);
+	da_move(context->expired_configs, context->retired_configs);
+}
+
+static void source_clone_free_rings(struct audio_ring **rings, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		audio_ring_free(rings[i]);
+		bfree(rings[i]);
+	}
+}
+
+static void source_clone_reclaim_rings(struct source_clone *context)
+{
+	source_clone_free_rings(context->expired_rings.array, context->expired_rings.num);
+	da_free(context->expired_rings);
+	da_move(context->expired_rings, context->retired_rings);
+}
+
+static void source_clone_profile_names(struct source_clone *context, const char *name)
+{
+	context->profile_render = clone_trace_name("source_clone_video_render(%s)", name);
+	context->profile_buffer_render = clone_trace_name("source_clone_buffer_render(%s)", name);
+	context->profile_draw_frame = clone_trace_name("source_clone_draw_frame(%s)", name);
+	context->profile_audio = clone_trace_name("source_clone_audio_drain(%s)", name);
+}
+
+static void source_clone_rename(void *data, calldata_t *cd)
+{
+	source_clone_profile_names(data, calldata_string(cd, "new_name"));
 }
 
 static void *source_clone_create(obs_data_t *settings, obs_source_t *source)
@@ -74,18 +167,27 @@ static void *source_clone_create(obs_data_t *settings, obs_source_t *source)
 	UNUSED_PARAMETER(settings);
 	struct source_clone *context = bzalloc(sizeof(struct source_clone));
 	context->source = source;
-	pthread_mutex_init(&context->audio_mutex, NULL);
+	context->config = bzalloc(sizeof(struct clone_config));
 	context->cx = 1;
 	context->cy = 1;
+	context->buffer_cx = 1;
+	context->buffer_cy = 1;
 	obs_source_update(source, NULL);
 	signal_handler_t *sh = obs_source_get_signal_handler(source);
 	signal_handler_connect(sh, "remove", source_clone_remove, context);
+	signal_handler_connect(sh, "rename", source_clone_rename, context);
+	source_clone_profile_names(context, obs_source_get_name(source));
+	clone_stats_add_proc(context);
+	os_atomic_inc_long(&clone_count);
 	return context;
 }
 
 static void source_clone_destroy(void *data)
 {
 	struct source_clone *context = data;
+	clone_index_remove(context);
+	clone_graph_remove(context);
+	source_clone_cancel_resolve(context);
 	if (context->audio_wrapper) {
 		audio_wrapper_remove(context->audio_wrapper, context);
 		context->audio_wrapper = NULL;
@@ -96,28 +198,77 @@ static void source_clone_destroy(void *data)
 		signal_handler_disconnect(sh, "audio_activate", source_clone_audio_activate, data);
 		signal_handler_disconnect(sh, "audio_deactivate", source_clone_audio_deactivate, data);
 		obs_source_remove_audio_capture_callback(source, source_clone_audio_callback, data);
-		if (obs_source_showing(context->source))
+		if (source_clone_target_showing(context))
 			obs_source_dec_showing(source);
 		if (context->active_clone && obs_source_active(context->source))
 			obs_source_dec_active(source);
 		obs_source_release(source);
 	}
 	obs_weak_source_release(context->clone);
+	obs_source_release(context->frame_source);
 	obs_weak_source_release(context->current_scene);
-	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-		deque_free(&context->audio_data[i]);
-	}
-	deque_free(&context->audio_frames);
-	deque_free(&context->audio_timestamps);
-	if (context->render) {
+	obs_weak_source_release(context->frozen_scene);
+	scene_tracker_release(context->scene_tracker);
+	if (context->audio_low_latency)
+		audio_forward_remove(context);
+	long dropped = context->audio_ring ? os_atomic_load_long(&context->audio_ring->dropped_frames) : 0;
+	if (dropped)
+		blog(LOG_INFO, "[Source Clone] '%s' dropped %ld audio frames", obs_source_get_name(context->source),
+		     dropped);
+	if (context->audio_ring)
+		source_clone_free_rings(&context->audio_ring, 1);
+	source_clone_free_rings(context->retired_rings.array, context->retired_rings.num);
+	da_free(context->retired_rings);
+	source_clone_free_rings(context->expired_rings.array, context->expired_rings.num);
+	da_free(context->expired_rings);
+	bfree(context->audio_merge_data);
+	// pooled targets outlive size changes, they go when the last clone does
+	const bool last_clone = os_atomic_dec_long(&clone_count) == 0;
+	if (context->render_cache || context->freeze_texture || last_clone) {
 		obs_enter_graphics();
-		gs_texrender_destroy(context->render);
+		render_cache_release(context->render_cache);
+		gs_texture_destroy(context->freeze_texture);
+		if (last_clone)
+			render_pool_free();
 		obs_leave_graphics();
 	}
-	pthread_mutex_destroy(&context->audio_mutex);
+	for (size_t i = 0; i < context->retired_configs.num; i++)
+		bfree(context->retired_configs.array[i]);
+	da_free(context->retired_configs);
+	for (size_t i = 0; i < context->expired_configs.num; i++)
+		bfree(context->expired_configs.array[i]);
+	da_free(context->expired_configs);
+	bfree((void *)context->config);
 	bfree(context);
 }
 
+#define AUDIO_BUFFER_MAX_MS 10000
+
+static uint32_t source_clone_audio_max_frames(struct source_clone *context)
+{
+	return audio_ring_frames_from_ms(audio_output_get_sample_rate(obs_get_audio()), context->audio_buffer);
+}
+
+static void source_clone_resize_audio(struct source_clone *context)
+{
+	const uint32_t max_frames = source_clone_audio_max_frames(context);
+	struct audio_ring *old = context->audio_ring;
+	if (old && audio_ring_sized_for(old, max_frames)) {
+		audio_ring_set_limit(old, max_frames, context->audio_overflow);
+		return;
+	}
+	const audio_t *a = obs_get_audio();
+	struct audio_ring *ring = bzalloc(sizeof(struct audio_ring));
+	audio_ring_init(ring, audio_output_get_channels(a), audio_output_get_sample_rate(a), max_frames);
+	audio_ring_set_limit(ring, max_frames, context->audio_overflow);
+	if (old) {
+		os_atomic_set_long(&ring->dropped_frames, os_atomic_load_long(&old->dropped_frames));
+		// the audio and forward threads may still be using the old ring, free it a frame later
+		da_push_back(context->retired_rings, &old);
+	}
+	clone_atomic_store_ptr((void *volatile *)&context->audio_ring, ring);
+}
+
 void source_clone_switch_source(struct source_clone *context, obs_source_t *source)
 {
 	if (context->audio_wrapper) {
@@ -130,15 +281,17 @@ void source_clone_switch_source(struct source_clone *context, obs_source_t *sour
 		signal_handler_disconnect(sh, "audio_activate", source_clone_audio_activate, context);
 		signal_handler_disconnect(sh, "audio_deactivate", source_clone_audio_deactivate, context);
 		obs_source_remove_audio_capture_callback(prev_source, source_clone_audio_callback, context);
-		if (obs_source_showing(context->source))
+		if (source_clone_target_showing(context))
 			obs_source_dec_showing(prev_source);
 		if (context->active_clone && obs_source_active(context->source))
-			obs_source_dec_active(source);
+			obs_source_dec_active(prev_source);
 		obs_source_release(prev_source);
 	}
 	obs_weak_source_release(context->clone);
 	context->clone = obs_source_get_weak_source(source);
-	if (context->audio_enabled) {
+	if (context->audio_enabled)
+		source_clone_resize_audio(context);
+	if (context->audio_enabled && source) {
 		uint32_t flags = obs_source_get_output_flags(source);
 		if ((flags & OBS_SOURCE_AUDIO) != 0) {
 			obs_source_add_audio_capture_callback(source, source_clone_audio_callback, context);
@@ -157,10 +310,46 @@ void source_clone_switch_source(struct source_clone *context, obs_source_t *sour
 	} else {
 		obs_source_set_audio_active(context->source, false);
 	}
-	if (source && obs_source_showing(context->source))
+	if (source && source_clone_target_showing(context))
 		obs_source_inc_showing(source);
 	if (source && context->active_clone && obs_source_active(context->source))
 		obs_source_inc_active(source);
+	clone_graph_set(context, source);
+}
+
+static const char *source_clone_target(obs_data_t *settings)
+{
+	const char *source_uuid = obs_data_get_string(settings, "clone_uuid");
+	return *source_uuid ? source_uuid : obs_data_get_string(settings, "clone");
+}
+
+static obs_source_t *source_clone_resolve(struct source_clone *context, obs_canvas_t *canvas, obs_data_t *settings)
+{
+	const char *source_uuid = obs_data_get_string(settings, "clone_uuid");
+	const char *source_name = obs_data_get_string(settings, "clone");
+	obs_source_t *source = NULL;
+	bool stale_uuid = false;
+	if (*source_uuid) {
+		source = obs_get_source_by_uuid(source_uuid);
+		if (source && strcmp(obs_source_get_name(source), source_name) != 0) {
+			obs_source_release(source);
+			source = NULL;
+			stale_uuid = true;
+		}
+	}
+	if (!source && canvas)
+		source = obs_canvas_get_source_by_name(canvas, source_name);
+	if (!source)
+		source = obs_get_source_by_name(source_name);
+	if (source == context->source) {
+		obs_source_release(source);
+		source = NULL;
+	}
+	if (source)
+		obs_data_set_string(settings, "clone_uuid", obs_source_get_uuid(source));
+	else if (stale_uuid)
+		obs_data_erase(settings, "clone_uuid");
+	return source;
 }
 
 void source_clone_load(void *data, obs_data_t *settings)
@@ -172,9 +361,13 @@ void source_clone_load(void *data, obs_data_t *settings)
 void source_clone_update(void *data, obs_data_t *settings)
 {
 	struct source_clone *context = data;
+	struct clone_config *config = bzalloc(sizeof(struct clone_config));
 	bool audio_enabled = obs_data_get_bool(settings, "audio");
 	bool active_clone = obs_data_get_bool(settings, "active_clone");
-	context->clone_type = obs_data_get_int(settings, "clone_type");
+	config->clone_type = obs_data_get_int(settings, "clone_type");
+	context->audio_buffer = (uint32_t)obs_data_get_int(settings, "audio_buffer");
+	context->audio_overflow = (enum audio_overflow)obs_data_get_int(settings, "audio_overflow");
+	config->audio_merge = (uint32_t)obs_data_get_int(settings, "audio_merge");
 	bool async = true;
 	bool custom_draw = true;
 	const char *canvas_name = obs_data_get_string(settings, "canvas");
@@ -198,22 +391,25 @@ void source_clone_update(void *data, obs_data_t *settings)
 		context->canvas = NULL;
 	}
 
-	if (context->clone_type == CLONE_SOURCE) {
-		const char *source_name = obs_data_get_string(settings, "clone");
-		obs_source_t *source = NULL;
-		if (context->canvas) {
-			obs_canvas_t *canvas = obs_weak_canvas_get_canvas(context->canvas);
-			if (canvas) {
-				source = obs_canvas_get_source_by_name(canvas, source_name);
-				obs_canvas_release(canvas);
-			}
-		}
-		if (!source)
-			source = obs_get_source_by_name(source_name);
-		if (source == context->source) {
-			obs_source_release(source);
-			source = NULL;
+	if (config->clone_type == CLONE_CURRENT_SCENE || config->clone_type == CLONE_PREVIOUS_SCENE) {
+		obs_canvas_t *canvas = obs_weak_canvas_get_canvas(context->canvas);
+		if (!scene_tracker_uses(context->scene_tracker, canvas)) {
+			scene_tracker_release(context->scene_tracker);
+			context->scene_tracker = scene_tracker_acquire(canvas);
 		}
+		obs_canvas_release(canvas);
+		context->scene_generation = -1;
+	} else if (context->scene_tracker) {
+		scene_tracker_release(context->scene_tracker);
+		context->scene_tracker = NULL;
+	}
+
+	if (config->clone_type == CLONE_SOURCE && os_atomic_load_bool(&clone_loader.loading)) {
+		source_clone_defer_resolve(context);
+	} else if (config->clone_type == CLONE_SOURCE) {
+		obs_canvas_t *canvas = obs_weak_canvas_get_canvas(context->canvas);
+		obs_source_t *source = source_clone_resolve(context, canvas, settings);
+		obs_canvas_release(canvas);
 		if (source) {
 			uint32_t output_flags = obs_source_get_output_flags(source);
 			async = (output_flags & OBS_SOURCE_ASYNC) != 0;
@@ -226,7 +422,18 @@ void source_clone_update(void *data, obs_data_t *settings)
 			obs_source_release(source);
 		}
 	}
+	clone_index_update(context, config->clone_type, source_clone_target(settings));
 	context->audio_enabled = audio_enabled;
+	if (audio_enabled && context->audio_ring)
+		source_clone_resize_audio(context);
+	bool audio_low_latency = audio_enabled && obs_data_get_bool(settings, "audio_low_latency");
+	if (audio_low_latency != context->audio_low_latency) {
+		context->audio_low_latency = audio_low_latency;
+		if (audio_low_latency)
+			audio_forward_add(context);
+		else
+			audio_forward_remove(context);
+	}
 	if (active_clone != context->active_clone) {
 		if (obs_source_active(context->source)) {
 			obs_source_t *clone = obs_weak_source_get_source(context->clone);
@@ -240,128 +447,64 @@ void source_clone_update(void *data, obs_data_t *settings)
 		}
 		context->active_clone = active_clone;
 	}
-	context->num_channels = audio_output_get_channels(obs_get_audio());
-	context->buffer_frame = (uint8_t)obs_data_get_int(settings, "buffer_frame");
-	context->no_filter = obs_data_get_bool(settings, "no_filters") && !async && !custom_draw;
+	config->buffer_frame = (uint8_t)obs_data_get_int(settings, "buffer_frame");
+	long long buffer_fps = obs_data_get_int(settings, "buffer_fps");
+	config->buffer_interval = buffer_fps > 0 ? 1000000000ULL / (uint64_t)buffer_fps : 0;
+	config->skip_unchanged = obs_data_get_bool(settings, "skip_unchanged");
+	config->buffer_percent = (uint32_t)obs_data_get_int(settings, "buffer_percent");
+	config->buffer_width = (uint32_t)obs_data_get_int(settings, "buffer_width");
+	config->buffer_height = (uint32_t)obs_data_get_int(settings, "buffer_height");
+	config->scale_filter = (enum clone_scale_filter)obs_data_get_int(settings, "scale_filter");
+	config->buffer_format = (enum clone_buffer_format)obs_data_get_int(settings, "buffer_format");
+	config->crop.left = (uint32_t)obs_data_get_int(settings, "crop_left");
+	config->crop.top = (uint32_t)obs_data_get_int(settings, "crop_top");
+	config->crop.right = (uint32_t)obs_data_get_int(settings, "crop_right");
+	config->crop.bottom = (uint32_t)obs_data_get_int(settings, "crop_bottom");
+	config->freeze_previous = obs_data_get_bool(settings, "freeze_previous");
+	config->idle_timeout = (uint64_t)obs_data_get_int(settings, "idle_timeout") * 1000000000ULL;
+	// a crop or a frozen frame is kept in the buffer, so it needs at least a full size buffer
+	if (!config->buffer_frame &&
+	    (config->crop.left || config->crop.top || config->crop.right || config->crop.bottom ||
+	     (config->freeze_previous && config->clone_type == CLONE_PREVIOUS_SCENE)))
+		config->buffer_frame = 1;
+	config->no_filter = obs_data_get_bool(settings, "no_filters") && !async && !custom_draw;
+	source_clone_publish_config(context, config);
 }
 
 void source_clone_defaults(obs_data_t *settings)
 {
 	UNUSED_PARAMETER(settings);
 	obs_data_set_default_bool(settings, "audio", false);
+	obs_data_set_default_int(settings, "audio_buffer", 1000);
+	obs_data_set_default_int(settings, "audio_overflow", AUDIO_OVERFLOW_DROP_OLDEST);
+	obs_data_set_default_int(settings, "audio_merge", 100);
+	obs_data_set_default_int(settings, "buffer_percent", 50);
 }
 
-bool source_clone_list_add_source(void *data, obs_source_t *source)
-{
-	obs_property_t *prop = data;
-
-	const char *name = obs_source_get_name(source);
-	size_t count = obs_property_list_item_count(prop);
-	size_t idx = 0;
-	while (idx < count && strcmp(name, obs_property_list_item_string(prop, idx)) > 0)
-		idx++;
-	obs_property_list_insert_string(prop, idx, name, name);
-	return true;
-}
-
-bool source_clone_list_add_canvas_scene(void *data, obs_canvas_t *canvas)
-{
-	obs_canvas_enum_scenes(canvas, source_clone_list_add_source, data);
-	return true;
-}
-
-bool source_clone_list_add_canvas(void *data, obs_canvas_t *canvas)
-{
-	obs_property_t *prop = data;
-
-	const char *name = obs_canvas_get_name(canvas);
-	size_t count = obs_property_list_item_count(prop);
-	size_t idx = 0;
-	while (idx < count && strcmp(name, obs_property_list_item_string(prop, idx)) > 0)
-		idx++;
-	obs_property_list_insert_string(prop, idx, name, name);
-	return true;
-}
-
-struct same_clones {
-	obs_data_t *settings;
-	DARRAY(const char *) clones;
-};
-
-bool find_clones(void *data, obs_source_t *source)
-{
-	if (strcmp(obs_source_get_unversioned_id(source), "source-clone") != 0) {
-
-		return true;
-	}
-	obs_data_t *settings = obs_source_get_settings(source);
-	if (!settings)
-		return true;
-	struct same_clones *sc = data;
-	if (settings == sc->settings) {
-		obs_data_release(settings);
-		return true;
-	}
-	if (obs_data_get_int(sc->settings, "clone_type") == CLONE_SOURCE) {
-		if (obs_data_get_int(settings, "clone_type") == CLONE_SOURCE &&
-		    strcmp(obs_data_get_string(sc->settings, "clone"), obs_data_get_string(settings, "clone")) == 0) {
-			const char *name = obs_source_get_name(source);
-			da_push_back(sc->clones, &name);
-		}
-	} else if (obs_data_get_int(sc->settings, "clone_type") == obs_data_get_int(settings, "clone_type")) {
-		const char *name = obs_source_get_name(source);
-		da_push_back(sc->clones, &name);
-	}
-	obs_data_release(settings);
-	return true;
-}
-
-void find_same_clones(obs_properties_t *props, obs_data_t *settings)
+void find_same_clones(struct source_clone *context, obs_properties_t *props, obs_data_t *settings)
 {
-	struct same_clones sc;
-	sc.settings = settings;
-	da_init(sc.clones);
-	obs_enum_sources(find_clones, &sc);
+	struct dstr names = {0};
+	clone_index_find(context, (int)obs_data_get_int(settings, "clone_type"), source_clone_target(settings), &names);
 	obs_property_t *prop = obs_properties_get(props, "same_clones");
-	if (sc.clones.num) {
-		struct dstr names;
-		dstr_init_copy(&names, sc.clones.array[0]);
-		for (size_t i = 1; i < sc.clones.num; i++) {
-			dstr_cat(&names, "\n");
-			dstr_cat(&names, sc.clones.array[i]);
-		}
+	if (names.len) {
 		obs_data_set_string(settings, "same_clones", names.array);
-		dstr_free(&names);
 		obs_property_set_visible(prop, true);
 	} else {
 		obs_data_unset_user_value(settings, "same_clones");
 		obs_property_set_visible(prop, false);
 	}
-	da_free(sc.clones);
+	dstr_free(&names);
 }
 
 bool source_clone_source_changed(void *priv, obs_properties_t *props, obs_property_t *property, obs_data_t *settings)
 {
 	UNUSED_PARAMETER(property);
 	struct source_clone *context = priv;
-	const char *canvas_name = obs_data_get_string(settings, "canvas");
-	const char *source_name = obs_data_get_string(settings, "clone");
 	bool async = true;
 	bool custom_draw = true;
-	obs_source_t *source = NULL;
-	if (canvas_name && strlen(canvas_name)) {
-		obs_canvas_t *canvas = obs_get_canvas_by_name(canvas_name);
-		if (canvas) {
-			source = obs_canvas_get_source_by_name(canvas, source_name);
-			obs_canvas_release(canvas);
-		}
-	}
-	if (!source)
-		source = obs_get_source_by_name(source_name);
-	if (source == context->source) {
-		obs_source_release(source);
-		source = NULL;
-	}
+	obs_canvas_t *canvas = obs_get_canvas_by_name(obs_data_get_string(settings, "canvas"));
+	obs_source_t *source = source_clone_resolve(context, canvas, settings);
+	obs_canvas_release(canvas);
 	if (source) {
 		uint32_t output_flags = obs_source_get_output_flags(source);
 		async = (output_flags & OBS_SOURCE_ASYNC) != 0;
@@ -372,55 +515,60 @@ bool source_clone_source_changed(void *priv, obs_properties_t *props, obs_proper
 	obs_property_t *no_filters = obs_properties_get(props, "no_filters");
 	obs_property_set_visible(no_filters, !async && !custom_draw);
 
-	find_same_clones(props, settings);
+	find_same_clones(context, props, settings);
 	return true;
 }
 
 bool source_clone_type_changed(void *priv, obs_properties_t *props, obs_property_t *property, obs_data_t *settings)
 {
-	UNUSED_PARAMETER(priv);
 	UNUSED_PARAMETER(property);
 	obs_property_t *clone = obs_properties_get(props, "clone");
 	const bool clone_source = obs_data_get_int(settings, "clone_type") == CLONE_SOURCE;
 	obs_property_set_visible(clone, clone_source);
+	obs_property_set_visible(obs_properties_get(props, "freeze_previous"),
+				 obs_data_get_int(settings, "clone_type") == CLONE_PREVIOUS_SCENE);
 	if (clone_source) {
 		source_clone_source_changed(priv, props, NULL, settings);
 	} else {
-		find_same_clones(props, settings);
+		find_same_clones(priv, props, settings);
 	}
 	return true;
 }
 
+bool source_clone_buffer_frame_changed(void *priv, obs_properties_t *props, obs_property_t *property,
+				       obs_data_t *settings)
+{
+	UNUSED_PARAMETER(priv);
+	UNUSED_PARAMETER(property);
+	const long long buffer_frame = obs_data_get_int(settings, "buffer_frame");
+	obs_property_set_visible(obs_properties_get(props, "buffer_percent"), buffer_frame == BUFFER_FRAME_PERCENT);
+	obs_property_set_visible(obs_properties_get(props, "buffer_width"), buffer_frame == BUFFER_FRAME_CUSTOM);
+	obs_property_set_visible(obs_properties_get(props, "buffer_height"), buffer_frame == BUFFER_FRAME_CUSTOM);
+	obs_property_set_visible(obs_properties_get(props, "scale_filter"), buffer_frame > 1);
+	obs_property_set_visible(obs_properties_get(props, "buffer_format"), buffer_frame > 0);
+	return true;
+}
+
 bool source_clone_canvas_changed(void *priv, obs_properties_t *props, obs_property_t *property, obs_data_t *settings)
 {
 	UNUSED_PARAMETER(priv);
 	UNUSED_PARAMETER(property);
 	obs_property_t *clone = obs_properties_get(props, "clone");
-	const char *canvas_name = obs_data_get_string(settings, "canvas");
-	obs_canvas_t *canvas = obs_get_canvas_by_name(canvas_name);
+	obs_data_erase(settings, "clone_uuid");
 	obs_property_list_clear(clone);
-	if (canvas) {
-		obs_canvas_enum_scenes(canvas, source_clone_list_add_source, clone);
-		obs_canvas_release(canvas);
-	} else {
-		obs_enum_scenes(source_clone_list_add_source, clone);
-	}
-	obs_enum_sources(source_clone_list_add_source, clone);
-	//add global audio sources
-	for (uint32_t i = 1; i < 7; i++) {
-		obs_source_t *s = obs_get_output_source(i);
-		if (!s)
-			continue;
-		source_clone_list_add_source(clone, s);
-		obs_source_release(s);
-	}
-	obs_property_list_insert_string(0, 0, "", "");
+	source_catalog_fill_sources(clone, obs_data_get_string(settings, "canvas"), false);
 	return true;
 }
 
 obs_properties_t *source_clone_properties(void *data)
 {
+	struct source_clone *context = data;
 	obs_properties_t *props = obs_properties_create();
+	if (context && context->cycle) {
+		obs_property_t *warning =
+			obs_properties_add_text(props, "cycle_warning", obs_module_text("CycleWarning"), OBS_TEXT_INFO);
+		obs_property_text_set_info_type(warning, OBS_TEXT_INFO_WARNING);
+	}
 	obs_property_t *p = obs_properties_add_list(props, "clone_type", obs_module_text("CloneType"),
 						    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_list_add_int(p, obs_module_text("Source"), CLONE_SOURCE);
@@ -431,27 +579,27 @@ obs_properties_t *source_clone_properties(void *data)
 
 	p = obs_properties_add_list(props, "canvas", obs_module_text("Canvas"), OBS_COMBO_TYPE_LIST,
 				    OBS_COMBO_FORMAT_STRING);
-	obs_enum_canvases(source_clone_list_add_canvas, p);
-	obs_property_list_insert_string(p, 0, "", "");
+	source_catalog_fill_canvases(p);
 
 	obs_property_set_modified_callback2(p, source_clone_canvas_changed, data);
 
 	p = obs_properties_add_list(props, "clone", obs_module_text("Clone"), OBS_COMBO_TYPE_EDITABLE,
 				    OBS_COMBO_FORMAT_STRING);
-	obs_enum_sources(source_clone_list_add_source, p);
-	obs_enum_canvases(source_clone_list_add_canvas_scene, p);
-	//add global audio sources
-	for (uint32_t i = 1; i < 7; i++) {
-		obs_source_t *s = obs_get_output_source(i);
-		if (!s)
-			continue;
-		source_clone_list_add_source(p, s);
-		obs_source_release(s);
-	}
-	obs_property_list_insert_string(p, 0, "", "");
+	source_catalog_fill_sources(p, NULL, true);
 	obs_property_set_modified_callback2(p, source_clone_source_changed, data);
 
 	obs_properties_add_bool(props, "audio", obs_module_text("Audio"));
+	obs_properties_add_bool(props, "audio_low_latency", obs_module_text("LowLatencyAudio"));
+	p = obs_properties_add_int_slider(props, "audio_buffer", obs_module_text("AudioBuffer"), 100,
+					  AUDIO_BUFFER_MAX_MS, 100);
+	obs_property_int_set_suffix(p, " ms");
+	p = obs_properties_add_list(props, "audio_overflow", obs_module_text("AudioOverflow"), OBS_COMBO_TYPE_LIST,
+				    OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("DropOldest"), AUDIO_OVERFLOW_DROP_OLDEST);
+	obs_property_list_add_int(p, obs_module_text("DropNewest"), AUDIO_OVERFLOW_DROP_NEWEST);
+	obs_property_list_add_int(p, obs_module_text("Resync"), AUDIO_OVERFLOW_RESYNC);
+	p = obs_properties_add_int_slider(props, "audio_merge", obs_module_text("AudioMerge"), 0, 500, 10);
+	obs_property_int_set_suffix(p, " ms");
 	p = obs_properties_add_list(props, "buffer_frame", obs_module_text("VideoBuffer"), OBS_COMBO_TYPE_LIST,
 				    OBS_COMBO_FORMAT_INT);
 	obs_property_list_add_int(p, obs_module_text("None"), 0);
@@ -459,9 +607,51 @@ obs_properties_t *source_clone_properties(void *data)
 	obs_property_list_add_int(p, obs_module_text("Half"), 2);
 	obs_property_list_add_int(p, obs_module_text("Third"), 3);
 	obs_property_list_add_int(p, obs_module_text("Quarter"), 4);
+	obs_property_list_add_int(p, obs_module_text("Percentage"), BUFFER_FRAME_PERCENT);
+	obs_property_list_add_int(p, obs_module_text("Custom"), BUFFER_FRAME_CUSTOM);
+	obs_property_set_modified_callback2(p, source_clone_buffer_frame_changed, data);
+	p = obs_properties_add_int_slider(props, "buffer_percent", obs_module_text("BufferPercent"), 1, 100, 1);
+	obs_property_int_set_suffix(p, "%");
+	p = obs_properties_add_int(props, "buffer_width", obs_module_text("Width"), 0, 16384, 1);
+	obs_property_int_set_suffix(p, " px");
+	p = obs_properties_add_int(props, "buffer_height", obs_module_text("Height"), 0, 16384, 1);
+	obs_property_int_set_suffix(p, " px");
+	p = obs_properties_add_list(props, "buffer_format", obs_module_text("BufferFormat"), OBS_COMBO_TYPE_LIST,
+				    OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("BufferFormat.Auto"), CLONE_FORMAT_AUTO);
+	obs_property_list_add_int(p, obs_module_text("BufferFormat.Sdr8"), CLONE_FORMAT_SDR_8);
+	obs_properties_t *crop = obs_properties_create();
+	p = obs_properties_add_int(crop, "crop_left", obs_module_text("Crop.Left"), 0, 16384, 1);
+	obs_property_int_set_suffix(p, " px");
+	p = obs_properties_add_int(crop, "crop_top", obs_module_text("Crop.Top"), 0, 16384, 1);
+	obs_property_int_set_suffix(p, " px");
+	p = obs_properties_add_int(crop, "crop_right", obs_module_text("Crop.Right"), 0, 16384, 1);
+	obs_property_int_set_suffix(p, " px");
+	p = obs_properties_add_int(crop, "crop_bottom", obs_module_text("Crop.Bottom"), 0, 16384, 1);
+	obs_property_int_set_suffix(p, " px");
+	obs_properties_add_group(props, "crop", obs_module_text("Crop"), OBS_GROUP_NORMAL, crop);
+	p = obs_properties_add_list(props, "scale_filter", obs_module_text("ScaleFilter"), OBS_COMBO_TYPE_LIST,
+				    OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("ScaleFilter.None"), CLONE_SCALE_NONE);
+	obs_property_list_add_int(p, obs_module_text("ScaleFilter.Bilinear"), CLONE_SCALE_BILINEAR);
+	obs_property_list_add_int(p, obs_module_text("ScaleFilter.Bicubic"), CLONE_SCALE_BICUBIC);
+	obs_property_list_add_int(p, obs_module_text("ScaleFilter.Area"), CLONE_SCALE_AREA);
+	obs_property_list_add_int(p, obs_module_text("ScaleFilter.Lanczos"), CLONE_SCALE_LANCZOS);
+	p = obs_properties_add_int(props, "buffer_fps", obs_module_text("VideoBufferFps"), 0, 240, 1);
+	obs_property_int_set_suffix(p, " fps");
+	obs_property_set_long_description(p, obs_module_text("VideoBufferFpsInfo"));
+	p = obs_properties_add_bool(props, "skip_unchanged", obs_module_text("SkipUnchanged"));
+	obs_property_set_long_description(p, obs_module_text("SkipUnchangedInfo"));
 
 	obs_properties_add_bool(props, "active_clone", obs_module_text("ActiveClone"));
 
+	p = obs_properties_add_bool(props, "freeze_previous", obs_module_text("FreezePrevious"));
+	obs_property_set_long_description(p, obs_module_text("FreezePreviousInfo"));
+
+	p = obs_properties_add_int(props, "idle_timeout", obs_module_text("IdleTimeout"), 0, 3600, 1);
+	obs_property_int_set_suffix(p, " s");
+	obs_property_set_long_description(p, obs_module_text("IdleTimeoutInfo"));
+
 	obs_properties_add_bool(props, "no_filters", obs_module_text("NoFilters"));
 
 	p = obs_properties_add_text(props, "same_clones", obs_module_text("SameClones"), OBS_TEXT_INFO);
@@ -520,6 +710,46 @@ static const char *get_tech_name_and_multiplier(enum gs_color_space current_spac
 	return tech_name;
 }
 
+static gs_effect_t *source_clone_scale_effect(struct source_clone *context, gs_texture_t *tex)
+{
+	const struct clone_config *config = source_clone_config(context);
+	if (context->buffer_cx == context->cx && context->buffer_cy == context->cy)
+		return obs_get_base_effect(OBS_EFFECT_DEFAULT);
+
+	gs_effect_t *effect;
+	switch (config->scale_filter) {
+	case CLONE_SCALE_BICUBIC:
+		effect = obs_get_base_effect(OBS_EFFECT_BICUBIC);
+		break;
+	case CLONE_SCALE_LANCZOS:
+		effect = obs_get_base_effect(OBS_EFFECT_LANCZOS);
+		break;
+	case CLONE_SCALE_AREA:
+		// area sampling only helps when shrinking, fall back to bilinear when enlarging
+		effect = context->cx < context->buffer_cx || context->cy < context->buffer_cy
+				 ? obs_get_base_effect(OBS_EFFECT_AREA)
+				 : obs_get_base_effect(OBS_EFFECT_DEFAULT);
+		break;
+	default:
+		return obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	}
+
+	struct vec2 dimension;
+	struct vec2 dimension_i;
+	vec2_set(&dimension, (float)gs_texture_get_width(tex), (float)gs_texture_get_height(tex));
+	vec2_set(&dimension_i, 1.0f / dimension.x, 1.0f / dimension.y);
+	gs_eparam_t *param = gs_effect_get_param_by_name(effect, "base_dimension");
+	if (param)
+		gs_effect_set_vec2(param, &dimension);
+	param = gs_effect_get_param_by_name(effect, "base_dimension_i");
+	if (param)
+		gs_effect_set_vec2(param, &dimension_i);
+	param = gs_effect_get_param_by_name(effect, "undistort_factor");
+	if (param)
+		gs_effect_set_float(param, 1.0f);
+	return effect;
+}
+
 static void source_clone_draw_frame(struct source_clone *context)
 {
 
@@ -527,54 +757,82 @@ static void source_clone_draw_frame(struct source_clone *context)
 	float multiplier;
 	const char *technique = get_tech_name_and_multiplier(current_space, context->space, &multiplier);
 
-	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
-	gs_texture_t *tex = gs_texrender_get_texture(context->render);
+	gs_texture_t *tex = context->freeze_texture ? context->freeze_texture
+						    : render_cache_get_texture(context->render_cache);
 	if (!tex)
 		return;
+	struct clone_scope scope;
+	clone_scope_start(&scope, context->profile_draw_frame, CLONE_TRACE_VIDEO);
+	gs_effect_t *effect = source_clone_scale_effect(context, tex);
 	const bool previous = gs_framebuffer_srgb_enabled();
 	gs_enable_framebuffer_srgb(true);
 
 	gs_effect_set_texture_srgb(gs_effect_get_param_by_name(effect, "image"), tex);
 	gs_effect_set_float(gs_effect_get_param_by_name(effect, "multiplier"), multiplier);
 
-	while (gs_effect_loop(effect, technique))
-		gs_draw_sprite(tex, 0, context->cx, context->cy);
+	const bool scaled = context->buffer_cx != context->cx || context->buffer_cy != context->cy;
+	if (scaled) {
+		gs_matrix_push();
+		gs_matrix_scale3f((float)context->cx / (float)context->buffer_cx,
+				  (float)context->cy / (float)context->buffer_cy, 1.0f);
+	}
+	// unscaled buffers may sit in the top left of a larger pooled target, at 1:1 nothing past them is sampled
+	while (gs_effect_loop(effect, technique)) {
+		if (scaled)
+			gs_draw_sprite(tex, 0, context->buffer_cx, context->buffer_cy);
+		else
+			gs_draw_sprite_subregion(tex, 0, 0, 0, context->buffer_cx, context->buffer_cy);
+	}
+	if (scaled)
+		gs_matrix_pop();
 
 	gs_enable_framebuffer_srgb(previous);
+	clone_scope_end(&scope);
 }
 
-void source_clone_video_render(void *data, gs_effect_t *effect)
+static void source_clone_capture_freeze(struct source_clone *context)
 {
-	UNUSED_PARAMETER(effect);
-	struct source_clone *context = data;
-	if (context->clone_type == CLONE_SOURCE && !context->clone)
+	gs_texture_t *tex = render_cache_get_texture(context->render_cache);
+	if (!tex)
+		return;
+	// the pooled target may be larger than the buffer, only the buffer region is kept
+	context->freeze_texture = gs_texture_create(context->buffer_cx, context->buffer_cy,
+						    gs_texture_get_color_format(tex), 1, NULL, 0);
+	if (!context->freeze_texture)
+		return;
+	gs_copy_texture_region(context->freeze_texture, 0, 0, tex, 0, 0, context->buffer_cx, context->buffer_cy);
+	context->freeze_pending = false;
+	// the scene is released in the next tick, not in the middle of rendering its parent
+	context->freeze_detach = true;
+}
+
+static void source_clone_render(struct source_clone *context)
+{
+	const struct clone_config *config = source_clone_config(context);
+	if (config->clone_type == CLONE_SOURCE && !context->clone)
 		return;
 
-	if (context->buffer_frame > 0 && context->processed_frame) {
+	context->last_drawn = obs_get_video_frame_time();
+	if (context->freeze_texture || (config->buffer_frame > 0 && context->processed_frame)) {
+		clone_stats_skip(context);
 		source_clone_draw_frame(context);
 		return;
 	}
-	if (context->rendering)
+	obs_source_t *source = context->frame_source;
+	if (context->rendering || !source)
 		return;
 	context->rendering = true;
-	obs_source_t *source = obs_weak_source_get_source(context->clone);
-	if (!source) {
-		context->rendering = false;
-		return;
-	}
-	if (context->buffer_frame == 0) {
-		if (context->no_filter) {
+	if (config->buffer_frame == 0) {
+		if (config->no_filter) {
 			obs_source_default_render(source);
 		} else {
 			obs_source_video_render(source);
 		}
-		obs_source_release(source);
 		context->rendering = false;
 		return;
 	}
 
 	if (!context->source_cx || !context->source_cy) {
-		obs_source_release(source);
 		context->rendering = false;
 		return;
 	}
@@ -584,82 +842,87 @@ void source_clone_video_render(void *data, gs_effect_t *effect)
 		GS_CS_SRGB_16F,
 		GS_CS_709_EXTENDED,
 	};
+	// compact formats render in SDR so libobs tonemaps once while filling the buffer
 	const enum gs_color_space space =
-		obs_source_get_color_space(source, OBS_COUNTOF(preferred_spaces), preferred_spaces);
+		config->buffer_format == CLONE_FORMAT_AUTO
+			? obs_source_get_color_space(source, OBS_COUNTOF(preferred_spaces), preferred_spaces)
+			: GS_CS_SRGB;
 	const enum gs_color_format format = gs_get_format_from_space(space);
-	if (!context->render || gs_texrender_get_format(context->render) != format) {
-		gs_texrender_destroy(context->render);
-		context->render = gs_texrender_create(format, GS_ZS_NONE);
-	} else {
-		gs_texrender_reset(context->render);
+	const bool exact = context->buffer_cx != context->cx || context->buffer_cy != context->cy;
+	if (!render_cache_matches(context->render_cache, source, config->no_filter, space, format, context->buffer_cx,
+				  context->buffer_cy, exact, &config->crop)) {
+		render_cache_release(context->render_cache);
+		context->render_cache = render_cache_acquire(source, config->no_filter, space, format,
+							     context->buffer_cx, context->buffer_cy, exact, &config->crop);
+		context->space = space;
 	}
 
-	gs_blend_state_push();
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	if (gs_texrender_begin_with_color_space(context->render, context->cx, context->cy, space)) {
-
-		struct vec4 clear_color;
-
-		vec4_zero(&clear_color);
-		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
-		if (context->source_cx && context->source_cy) {
-			gs_ortho(0.0f, (float)context->source_cx, 0.0f, (float)context->source_cy, -100.0f, 100.0f);
-			if (context->no_filter) {
-				obs_source_default_render(source);
-			} else {
-				obs_source_video_render(source);
-			}
-		}
-		gs_texrender_end(context->render);
-
-		context->space = space;
+	struct clone_scope scope;
+	clone_scope_start(&scope, context->profile_buffer_render, CLONE_TRACE_VIDEO);
+	const bool rendered = render_cache_render(context->render_cache, source, context->source_cx, context->source_cy,
+						  config->buffer_interval, config->skip_unchanged);
+	clone_scope_end(&scope);
+	if (!rendered) {
+		context->rendering = false;
+		return;
 	}
+	clone_stats_buffer(context, render_cache_get_frame_time(context->render_cache));
 
-	gs_blend_state_pop();
+	if (context->freeze_pending)
+		source_clone_capture_freeze(context);
 
 	context->processed_frame = true;
-	obs_source_release(source);
 	context->rendering = false;
 	source_clone_draw_frame(context);
 }
 
+void source_clone_video_render(void *data, gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(effect);
+	struct source_clone *context = data;
+	struct clone_scope scope;
+	clone_scope_start(&scope, context->profile_render, CLONE_TRACE_VIDEO);
+	const uint64_t start = os_gettime_ns();
+	source_clone_render(context);
+	clone_stats_render(context, os_gettime_ns() - start);
+	clone_scope_end(&scope);
+}
+
 uint32_t source_clone_get_width(void *data)
 {
 	struct source_clone *context = data;
+	const struct clone_config *config = source_clone_config(context);
+	if (context->freeze_texture)
+		return context->cx;
 	if (!context->clone)
 		return 1;
-	if (context->buffer_frame > 0)
+	if (config->buffer_frame > 0)
 		return context->cx;
-	obs_source_t *source = obs_weak_source_get_source(context->clone);
-	if (!source)
+	if (!context->frame_source)
 		return 1;
-	uint32_t width = context->no_filter ? obs_source_get_base_width(source) : obs_source_get_width(source);
-	obs_source_release(source);
-	if (context->buffer_frame > 1)
-		width /= context->buffer_frame;
-	return width;
+	return context->source_cx;
 }
 
 uint32_t source_clone_get_height(void *data)
 {
 	struct source_clone *context = data;
+	const struct clone_config *config = source_clone_config(context);
+	if (context->freeze_texture)
+		return context->cy;
 	if (!context->clone)
 		return 1;
-	if (context->buffer_frame > 0)
+	if (config->buffer_frame > 0)
 		return context->cy;
-	obs_source_t *source = obs_weak_source_get_source(context->clone);
-	if (!source)
+	if (!context->frame_source)
 		return 1;
-	uint32_t height = context->no_filter ? obs_source_get_base_height(source) : obs_source_get_height(source);
-	obs_source_release(source);
-	if (context->buffer_frame > 1)
-		height /= context->buffer_frame;
-	return height;
+	return context->source_cy;
 }
 
 void source_clone_show(void *data)
 {
 	struct source_clone *context = data;
+	context->idle = false;
+	context->last_drawn = obs_get_video_frame_time();
 	if (!context->clone)
 		return;
 	obs_source_t *source = obs_weak_source_get_source(context->clone);
@@ -672,6 +935,10 @@ void source_clone_show(void *data)
 void source_clone_hide(void *data)
 {
 	struct source_clone *context = data;
+	if (context->idle) {
+		context->idle = false;
+		return;
+	}
 	if (!context->clone)
 		return;
 	obs_source_t *source = obs_weak_source_get_source(context->clone);
@@ -708,8 +975,10 @@ void source_clone_deactivate(void *data)
 void source_clone_save(void *data, obs_data_t *settings)
 {
 	struct source_clone *context = data;
-	if (context->clone_type != CLONE_SOURCE) {
+	const struct clone_config *config = source_clone_config(context);
+	if (config->clone_type != CLONE_SOURCE) {
 		obs_data_set_string(settings, "clone", "");
+		obs_data_set_string(settings, "clone_uuid", "");
 		return;
 	}
 	if (!context->clone)
@@ -718,103 +987,321 @@ void source_clone_save(void *data, obs_data_t *settings)
 	if (!source)
 		return;
 	obs_data_set_string(settings, "clone", obs_source_get_name(source));
+	obs_data_set_string(settings, "clone_uuid", obs_source_get_uuid(source));
 	obs_source_release(source);
 }
 
+#define AUDIO_MERGE_THRESHOLD 1000000ULL
+
+static void source_clone_output_frames(struct source_clone *context, const struct audio_output_info *aoi,
+				       size_t channels, float *const *data, uint32_t frames, uint64_t timestamp)
+{
+	struct obs_source_audio audio;
+	audio.format = aoi->format;
+	audio.samples_per_sec = aoi->samples_per_sec;
+	audio.speakers = aoi->speakers;
+	audio.frames = frames;
+	audio.timestamp = timestamp;
+	for (size_t i = 0; i < channels; i++) {
+		audio.data[i] = (uint8_t *)data[i];
+	}
+	obs_source_output_audio(context->source, &audio);
+}
+
+static uint32_t source_clone_merge_packets(struct source_clone *context, struct audio_ring *ring,
+					   struct audio_ring_packet *packet, uint32_t max_frames, uint64_t *timestamp)
+{
+	if (context->audio_merge_capacity < max_frames) {
+		context->audio_merge_data =
+			brealloc(context->audio_merge_data, ring->channels * max_frames * sizeof(float));
+		context->audio_merge_capacity = max_frames;
+	}
+	*timestamp = packet->timestamp;
+	uint32_t frames = 0;
+	do {
+		uint64_t expected = *timestamp + util_mul_div64(frames, 1000000000ULL, ring->sample_rate);
+		uint64_t diff = packet->timestamp > expected ? packet->timestamp - expected
+							     : expected - packet->timestamp;
+		if (frames && (diff > AUDIO_MERGE_THRESHOLD || frames + packet->frames > max_frames)) {
+			audio_ring_unpeek(ring);
+			break;
+		}
+		for (size_t i = 0; i < ring->channels; i++) {
+			float *dst = context->audio_merge_data + i * max_frames + frames;
+			float *src = audio_ring_packet_data(ring, packet, i);
+			if (src)
+				memcpy(dst, src, packet->frames * sizeof(float));
+			else
+				memset(dst, 0, packet->frames * sizeof(float));
+		}
+		frames += packet->frames;
+		audio_ring_pop(ring);
+	} while ((packet = audio_ring_peek(ring)) != NULL);
+	return frames;
+}
+
+void source_clone_output_audio(struct source_clone *context)
+{
+	if (!os_atomic_compare_swap_long(&context->audio_draining, 0, 1))
+		return;
+
+	struct audio_ring *ring = source_clone_audio_ring(context);
+	if (!ring) {
+		os_atomic_set_long(&context->audio_draining, 0);
+		return;
+	}
+	const audio_t *a = obs_get_audio();
+	const struct audio_output_info *aoi = audio_output_get_info(a);
+	// not audio_ring_frames_from_ms, merge values below one packet would round up to a full packet
+	uint32_t max_frames = (uint32_t)util_mul_div64(source_clone_config(context)->audio_merge, aoi->samples_per_sec,
+						       1000);
+
+	struct audio_ring_packet *packet;
+	while ((packet = audio_ring_peek(ring)) != NULL) {
+		float *data[MAX_AUDIO_CHANNELS];
+		if (packet->frames >= max_frames) {
+			for (size_t i = 0; i < ring->channels; i++) {
+				data[i] = audio_ring_packet_data(ring, packet, i);
+			}
+			source_clone_output_frames(context, aoi, ring->channels, data, packet->frames, packet->timestamp);
+			audio_ring_pop(ring);
+			continue;
+		}
+		uint64_t timestamp;
+		uint32_t frames = source_clone_merge_packets(context, ring, packet, max_frames, &timestamp);
+		for (size_t i = 0; i < ring->channels; i++) {
+			data[i] = context->audio_merge_data + i * max_frames;
+		}
+		source_clone_output_frames(context, aoi, ring->channels, data, frames, timestamp);
+	}
+	os_atomic_set_long(&context->audio_draining, 0);
+}
+
+static void source_clone_unfreeze(struct source_clone *context)
+{
+	context->freeze_pending = false;
+	context->freeze_detach = false;
+	obs_weak_source_release(context->frozen_scene);
+	context->frozen_scene = NULL;
+	if (!context->freeze_texture)
+		return;
+	obs_enter_graphics();
+	gs_texture_destroy(context->freeze_texture);
+	obs_leave_graphics();
+	context->freeze_texture = NULL;
+}
+
+static void source_clone_update_freeze(struct source_clone *context)
+{
+	const struct clone_config *config = source_clone_config(context);
+	if (context->freeze_detach) {
+		// drop the showing and active references so the old scene can go idle behind the still frame
+		context->freeze_detach = false;
+		obs_weak_source_release(context->frozen_scene);
+		context->frozen_scene = context->clone;
+		obs_weak_source_addref(context->frozen_scene);
+		source_clone_switch_source(context, NULL);
+	}
+	if (!context->freeze_texture && !context->freeze_pending)
+		return;
+	if (config->freeze_previous && config->clone_type == CLONE_PREVIOUS_SCENE)
+		return;
+	obs_source_t *scene = obs_weak_source_get_source(context->frozen_scene);
+	source_clone_unfreeze(context);
+	if (scene && config->clone_type == CLONE_PREVIOUS_SCENE)
+		source_clone_switch_source(context, scene);
+	obs_source_release(scene);
+}
+
+static void source_clone_update_idle(struct source_clone *context)
+{
+	const struct clone_config *config = source_clone_config(context);
+	const uint64_t now = obs_get_video_frame_time();
+	const bool idle = config->idle_timeout && obs_source_showing(context->source) &&
+			  now - context->last_drawn > config->idle_timeout;
+	if (idle == context->idle)
+		return;
+	obs_source_t *source = obs_weak_source_get_source(context->clone);
+	if (idle) {
+		if (source)
+			obs_source_dec_showing(source);
+		context->idle = true;
+	} else {
+		// drawn again (or the timeout was turned off), the target catches up from the next frame
+		context->idle = false;
+		if (source)
+			obs_source_inc_showing(source);
+	}
+	obs_source_release(source);
+}
+
+static void source_clone_update_cycle(struct source_clone *context)
+{
+	const long generation = clone_graph_generation();
+	if (generation == context->graph_generation)
+		return;
+	context->graph_generation = generation;
+	const bool cycle = clone_graph_has_cycle(context->source);
+	if (cycle && !context->cycle)
+		blog(LOG_WARNING, "[Source Clone] '%s' is part of a clone cycle, its nested copies are skipped",
+		     obs_source_get_name(context->source));
+	context->cycle = cycle;
+}
+
+static void source_clone_buffer_size(struct source_clone *context, uint32_t *cx, uint32_t *cy)
+{
+	const struct clone_config *config = source_clone_config(context);
+	const uint32_t source_cx = context->source_cx;
+	const uint32_t source_cy = context->source_cy;
+	*cx = 1;
+	*cy = 1;
+	if (!source_cx || !source_cy)
+		return;
+	switch (config->buffer_frame) {
+	case BUFFER_FRAME_PERCENT:
+		*cx = (uint32_t)util_mul_div64(source_cx, config->buffer_percent, 100);
+		*cy = (uint32_t)util_mul_div64(source_cy, config->buffer_percent, 100);
+		break;
+	case BUFFER_FRAME_CUSTOM:
+		// a zero dimension follows the aspect ratio of the source
+		if (config->buffer_width && config->buffer_height) {
+			*cx = config->buffer_width;
+			*cy = config->buffer_height;
+		} else if (config->buffer_width) {
+			*cx = config->buffer_width;
+			*cy = (uint32_t)util_mul_div64(config->buffer_width, source_cy, source_cx);
+		} else if (config->buffer_height) {
+			*cx = (uint32_t)util_mul_div64(config->buffer_height, source_cx, source_cy);
+			*cy = config->buffer_height;
+		} else {
+			*cx = source_cx;
+			*cy = source_cy;
+		}
+		break;
+	default:
+		*cx = source_cx / config->buffer_frame;
+		*cy = source_cy / config->buffer_frame;
+	}
+	if (!*cx)
+		*cx = 1;
+	if (!*cy)
+		*cy = 1;
+}
+
+static void source_clone_resolve_pending(void)
+{
+	if (!os_atomic_exchange_bool(&clone_loader.resolve, false))
+		return;
+	DARRAY(obs_source_t *) sources;
+	da_init(sources);
+	pthread_mutex_lock(&clone_loader.mutex);
+	for (size_t i = 0; i < clone_loader.pending.num; i++) {
+		struct source_clone *context = clone_loader.pending.array[i];
+		context->pending_resolve = false;
+		obs_source_t *source = obs_source_get_ref(context->source);
+		if (source)
+			da_push_back(sources, &source);
+	}
+	da_free(clone_loader.pending);
+	pthread_mutex_unlock(&clone_loader.mutex);
+
+	// each clone resolves in its own deferred update, clones that tick later this frame pick it up right away
+	for (size_t i = 0; i < sources.num; i++) {
+		obs_source_update(sources.array[i], NULL);
+		obs_source_release(sources.array[i]);
+	}
+	da_free(sources);
+}
+
 void source_clone_video_tick(void *data, float seconds)
 {
 	UNUSED_PARAMETER(seconds);
 	struct source_clone *context = data;
+	source_clone_reclaim_configs(context);
+	source_clone_reclaim_rings(context);
+	render_pool_tick();
+	const struct clone_config *config = source_clone_config(context);
 	context->processed_frame = false;
-
-	if (context->clone_type == CLONE_CURRENT_SCENE || context->clone_type == CLONE_PREVIOUS_SCENE) {
-		obs_source_t *source = NULL;
-		if (context->canvas) {
-			obs_canvas_t *canvas = obs_weak_canvas_get_canvas(context->canvas);
-			if (canvas) {
-				source = obs_canvas_get_channel(canvas, 0);
-				while (source && obs_source_get_type(source) == OBS_SOURCE_TYPE_TRANSITION) {
-					obs_source_t *ts = obs_transition_get_active_source(source);
-					if (ts) {
-						obs_source_release(source);
-						source = ts;
-					} else {
-						break;
-					}
+	source_clone_resolve_pending();
+
+	if (context->scene_tracker) {
+		scene_tracker_update(context->scene_tracker);
+		long generation = scene_tracker_generation(context->scene_tracker);
+		if (generation != context->scene_generation) {
+			context->scene_generation = generation;
+			obs_source_t *source = scene_tracker_get_scene(context->scene_tracker);
+			if (config->clone_type == CLONE_CURRENT_SCENE) {
+				if (!obs_weak_source_references_source(context->clone, source)) {
+					source_clone_switch_source(context, source);
+				}
+			} else if (config->clone_type == CLONE_PREVIOUS_SCENE) {
+				if (!obs_weak_source_references_source(context->current_scene, source)) {
+					obs_source_t *old_source = obs_weak_source_get_source(context->current_scene);
+					source_clone_unfreeze(context);
+					source_clone_switch_source(context, old_source);
+					context->freeze_pending = config->freeze_previous && old_source;
+					obs_source_release(old_source);
+					obs_weak_source_release(context->current_scene);
+					context->current_scene = obs_source_get_weak_source(source);
 				}
-				obs_canvas_release(canvas);
-			}
-		} else {
-			source = obs_frontend_get_current_scene();
-		}
-		if (context->clone_type == CLONE_CURRENT_SCENE) {
-			if (!obs_weak_source_references_source(context->clone, source)) {
-				source_clone_switch_source(context, source);
-			}
-		} else if (context->clone_type == CLONE_PREVIOUS_SCENE) {
-			if (!obs_weak_source_references_source(context->current_scene, source)) {
-				obs_source_t *old_source = obs_weak_source_get_source(context->current_scene);
-				source_clone_switch_source(context, old_source);
-				obs_source_release(old_source);
-				obs_weak_source_release(context->current_scene);
-				context->current_scene = obs_source_get_weak_source(source);
 			}
+			obs_source_release(source);
 		}
-		obs_source_release(source);
 	}
-	if (context->buffer_frame > 0) {
-		uint32_t cx = context->buffer_frame;
-		uint32_t cy = context->buffer_frame;
-		if (context->clone) {
-			obs_source_t *s = obs_weak_source_get_source(context->clone);
-			if (s) {
-				context->source_cx = context->no_filter ? obs_source_get_base_width(s)
-									: obs_source_get_width(s);
-				context->source_cy = context->no_filter ? obs_source_get_base_height(s)
-									: obs_source_get_height(s);
-
-				cx = context->source_cx;
-				cy = context->source_cy;
-				obs_source_release(s);
-			}
-		}
-		if (context->buffer_frame > 1) {
-			cx /= context->buffer_frame;
-			cy /= context->buffer_frame;
+	source_clone_update_freeze(context);
+	source_clone_update_idle(context);
+	source_clone_update_cycle(context);
+	obs_source_t *frame_source = obs_weak_source_get_source(context->clone);
+	if (frame_source && obs_source_removed(frame_source)) {
+		obs_source_release(frame_source);
+		frame_source = NULL;
+	}
+	obs_source_release(context->frame_source);
+	context->frame_source = frame_source;
+	if (frame_source) {
+		uint32_t source_cx = config->no_filter ? obs_source_get_base_width(frame_source)
+						       : obs_source_get_width(frame_source);
+		uint32_t source_cy = config->no_filter ? obs_source_get_base_height(frame_source)
+						       : obs_source_get_height(frame_source);
+		// the snapshot size is the region left after cropping
+		const uint32_t crop_cx = config->crop.left + config->crop.right;
+		const uint32_t crop_cy = config->crop.top + config->crop.bottom;
+		context->source_cx = source_cx > crop_cx ? source_cx - crop_cx : 0;
+		context->source_cy = source_cy > crop_cy ? source_cy - crop_cy : 0;
+	} else {
+		context->source_cx = 0;
+		context->source_cy = 0;
+	}
+	if (config->buffer_frame > 0 && !context->freeze_texture) {
+		uint32_t cx;
+		uint32_t cy;
+		source_clone_buffer_size(context, &cx, &cy);
+		context->cx = cx;
+		context->cy = cy;
+		// with a scale filter the buffer keeps the full source size and is scaled when drawn
+		if (config->scale_filter != CLONE_SCALE_NONE && context->source_cx && context->source_cy) {
+			cx = context->source_cx;
+			cy = context->source_cy;
 		}
-		if (cx != context->cx || cy != context->cy) {
-			context->cx = cx;
-			context->cy = cy;
+		if (cx != context->buffer_cx || cy != context->buffer_cy) {
+			context->buffer_cx = cx;
+			context->buffer_cy = cy;
 			obs_enter_graphics();
-			gs_texrender_destroy(context->render);
-			context->render = NULL;
+			render_cache_release(context->render_cache);
+			context->render_cache = NULL;
 			obs_leave_graphics();
 		}
 	}
 	if (!context->audio_enabled)
 		return;
+	clone_stats_audio(context);
+	if (context->audio_low_latency)
+		return;
 
-	const audio_t *a = obs_get_audio();
-	const struct audio_output_info *aoi = audio_output_get_info(a);
-
-	pthread_mutex_lock(&context->audio_mutex);
-	while (context->audio_frames.size > 0) {
-		struct obs_source_audio audio;
-		audio.format = aoi->format;
-		audio.samples_per_sec = aoi->samples_per_sec;
-		audio.speakers = aoi->speakers;
-		deque_pop_front(&context->audio_frames, &audio.frames, sizeof(audio.frames));
-		deque_pop_front(&context->audio_timestamps, &audio.timestamp, sizeof(audio.timestamp));
-		for (size_t i = 0; i < context->num_channels; i++) {
-			audio.data[i] = (uint8_t *)context->audio_data[i].data + context->audio_data[i].start_pos;
-		}
-		obs_source_output_audio(context->source, &audio);
-		for (size_t i = 0; i < context->num_channels; i++) {
-			deque_pop_front(&context->audio_data[i], NULL, audio.frames * sizeof(float));
-		}
-	}
-	context->num_channels = audio_output_get_channels(a);
-	pthread_mutex_unlock(&context->audio_mutex);
+	struct clone_scope scope;
+	clone_scope_start(&scope, context->profile_audio, CLONE_TRACE_VIDEO);
+	source_clone_output_audio(context);
+	clone_scope_end(&scope);
 }
 
 struct obs_source_info source_clone_info = {
@@ -852,11 +1339,37 @@ MODULE_EXPORT const char *obs_module_name(void)
 	return obs_module_text("SourceClone");
 }
 
-void audio_wrapper_frontend_event(enum obs_frontend_event event, void *private_data)
+static void source_clone_rename_target(void *param, struct source_clone *context)
+{
+	obs_data_t *settings = obs_source_get_settings(context->source);
+	obs_data_set_string(settings, "clone", param);
+	obs_data_release(settings);
+}
+
+static void source_clone_source_rename(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	obs_source_t *source = calldata_ptr(cd, "source");
+	if (!source)
+		return;
+	clone_index_enum(CLONE_SOURCE, obs_source_get_uuid(source), source_clone_rename_target,
+			 (void *)calldata_string(cd, "new_name"));
+}
+
+void source_clone_frontend_event(enum obs_frontend_event event, void *private_data)
 {
 	UNUSED_PARAMETER(private_data);
 	if (event == OBS_FRONTEND_EVENT_SCRIPTING_SHUTDOWN || event == OBS_FRONTEND_EVENT_EXIT) {
 		audio_wrapper_cleanup();
+	} else if (event == OBS_FRONTEND_EVENT_SCENE_CHANGED) {
+		scene_tracker_invalidate_all();
+	} else if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING) {
+		os_atomic_set_bool(&clone_loader.loading, true);
+	} else if (event == OBS_FRONTEND_EVENT_FINISHED_LOADING ||
+		   event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED) {
+		os_atomic_set_bool(&clone_loader.loading, false);
+		os_atomic_set_bool(&clone_loader.resolve, true);
+		scene_tracker_invalidate_all();
 	}
 }
 
@@ -865,12 +1378,26 @@ bool obs_module_load(void)
 	blog(LOG_INFO, "[Source Clone] loaded version %s", PROJECT_VERSION);
 	obs_register_source(&source_clone_info);
 	obs_register_source(&audio_wrapper_source);
-	obs_frontend_add_event_callback(audio_wrapper_frontend_event, NULL);
+	obs_frontend_add_event_callback(source_clone_frontend_event, NULL);
+	signal_handler_connect(obs_get_signal_handler(), "source_rename", source_clone_source_rename, NULL);
+	// without a frontend (the headless benchmark) there is no scene collection load to wait for
+	if (!obs_frontend_get_main_window())
+		os_atomic_set_bool(&clone_loader.loading, false);
+	source_catalog_init();
+	scene_tracker_init();
+	clone_stats_init();
+	clone_trace_init();
 	return true;
 }
 
 void obs_module_unload(void)
 {
 	audio_wrapper_cleanup();
-	obs_frontend_remove_event_callback(audio_wrapper_frontend_event, NULL);
+	audio_forward_free();
+	audio_block_pool_free();
+	clone_trace_free();
+	signal_handler_disconnect(obs_get_signal_handler(), "source_rename", source_clone_source_rename, NULL);
+	source_catalog_free();
+	scene_tracker_free();
+	obs_frontend_remove_event_callback(source_clone_frontend_event, NULL);
 }
@@ -2,8 +2,11 @@
 
 #include "version.h"
 #include <obs-module.h>
-#include <util/deque.h>
-#include <util/threading.h>
+#include <util/darray.h>
+#include "audio-ring.h"
+#include "render-cache.h"
+#include "clone-stats.h"
+#include "clone-atomic.h"
 
 enum clone_type {
 	CLONE_SOURCE,
@@ -11,29 +14,102 @@ enum clone_type {
 	CLONE_PREVIOUS_SCENE,
 };
 
+#define BUFFER_FRAME_PERCENT 254
+#define BUFFER_FRAME_CUSTOM 255
+
+enum clone_scale_filter {
+	CLONE_SCALE_NONE,
+	CLONE_SCALE_BILINEAR,
+	CLONE_SCALE_BICUBIC,
+	CLONE_SCALE_AREA,
+	CLONE_SCALE_LANCZOS,
+};
+
+enum clone_buffer_format {
+	CLONE_FORMAT_AUTO,
+	CLONE_FORMAT_SDR_8,
+};
+
+// settings read while rendering, replaced as a whole on update and never modified once published
+struct clone_config {
+	enum clone_type clone_type;
+	uint8_t buffer_frame;
+	uint64_t buffer_interval;
+	bool skip_unchanged;
+	uint32_t buffer_percent;
+	uint32_t buffer_width;
+	uint32_t buffer_height;
+	enum clone_scale_filter scale_filter;
+	struct render_crop crop;
+	enum clone_buffer_format buffer_format;
+	bool freeze_previous;
+	uint64_t idle_timeout;
+	bool no_filter;
+	uint32_t audio_merge;
+};
+
 struct source_clone {
 	obs_source_t *source;
-	enum clone_type clone_type;
+	const struct clone_config *config;
+	DARRAY(struct clone_config *) retired_configs;
+	DARRAY(struct clone_config *) expired_configs;
 	obs_weak_canvas_t *canvas;
 	obs_weak_source_t *clone;
+	obs_source_t *frame_source;
 	obs_weak_source_t *current_scene;
+	struct scene_tracker *scene_tracker;
+	long scene_generation;
 	struct audio_wrapper_info *audio_wrapper;
-	struct deque audio_data[MAX_AUDIO_CHANNELS];
-	struct deque audio_frames;
-	struct deque audio_timestamps;
-	uint64_t audio_ts;
-	size_t num_channels;
-	pthread_mutex_t audio_mutex;
-	gs_texrender_t *render;
+	// replaced when the buffer length changes, the audio threads load it with source_clone_audio_ring
+	struct audio_ring *audio_ring;
+	DARRAY(struct audio_ring *) retired_rings;
+	DARRAY(struct audio_ring *) expired_rings;
+	// only read on the graphics thread, the audio threads see them through the ring limit
+	uint32_t audio_buffer;
+	enum audio_overflow audio_overflow;
+	float *audio_merge_data;
+	uint32_t audio_merge_capacity;
+	volatile long audio_draining;
+	struct render_cache *render_cache;
 	bool processed_frame;
+	// not part of the config, it changes together with the audio hookups in source_clone_switch_source
 	bool audio_enabled;
-	uint8_t buffer_frame;
+	bool audio_low_latency;
+	bool freeze_pending;
+	bool freeze_detach;
+	gs_texture_t *freeze_texture;
+	obs_weak_source_t *frozen_scene;
+	uint64_t last_drawn;
+	bool idle;
+	struct source_clone_stats stats;
+	const char *profile_render;
+	const char *profile_buffer_render;
+	const char *profile_draw_frame;
+	const char *profile_audio;
+	long graph_generation;
+	bool cycle;
 	uint32_t cx;
 	uint32_t cy;
+	uint32_t buffer_cx;
+	uint32_t buffer_cy;
 	uint32_t source_cx;
 	uint32_t source_cy;
 	enum gs_color_space space;
 	bool rendering;
 	bool active_clone;
-	bool no_filter;
+	char *index_key;
+	bool pending_resolve;
 };
+
+// published with a release store on update, read from any thread
+static inline const struct clone_config *source_clone_config(struct source_clone *context)
+{
+	return clone_atomic_load_ptr((void *volatile *)&context->config);
+}
+
+static inline struct audio_ring *source_clone_audio_ring(struct source_clone *context)
+{
+	return clone_atomic_load_ptr((void *volatile *)&context->audio_ring);
+}
+
+void source_clone_output_audio(struct source_clone *context);